@@ -0,0 +1,124 @@
+package io.roastedroot.jq4j.benchmarks;
+
+import io.roastedroot.jq4j.JqReactorPool;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import org.openjdk.jmh.annotations.AuxCounters;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+/**
+ * {@link JqReactorPool} throughput with {@code threads} concurrent
+ * callers sharing one pool sized to the number of CPUs, on platform or
+ * virtual threads, with and without thread affinity.  One benchmark
+ * operation is a round of {@code threads x REQUESTS_PER_TASK} requests;
+ * the {@code requests} counter reports individual requests per second.
+ */
+@BenchmarkMode(Mode.Throughput)
+@OutputTimeUnit(TimeUnit.SECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+@State(Scope.Benchmark)
+public class JqReactorPoolBenchmark {
+
+    private static final int REQUESTS_PER_TASK = 8;
+
+    public enum Threads {
+        PLATFORM,
+        VIRTUAL
+    }
+
+    @Param({"1", "4", "16", "64"})
+    public int threads;
+
+    @Param
+    public Threads kind;
+
+    @Param({"1KB"})
+    public String size;
+
+    @Param({"false", "true"})
+    public boolean affinity;
+
+    private JqReactorPool pool;
+    private ExecutorService executor;
+    private List<Callable<Integer>> tasks;
+
+    @AuxCounters(AuxCounters.Type.OPERATIONS)
+    @State(Scope.Thread)
+    public static class Requests {
+        public long requests;
+
+        @Setup(Level.Iteration)
+        public void reset() {
+            requests = 0;
+        }
+    }
+
+    @Setup(Level.Trial)
+    public void setUp() {
+        var builder = JqReactorPool.builder()
+                .withMaxSize(Runtime.getRuntime().availableProcessors());
+        if (affinity) {
+            builder.withThreadAffinity();
+        }
+        pool = builder.build();
+        executor = kind == Threads.VIRTUAL
+                ? Executors.newVirtualThreadPerTaskExecutor()
+                : Executors.newFixedThreadPool(threads);
+
+        byte[] input = Payloads.array(Payloads.parseSize(size));
+        Callable<Integer> task = () -> {
+            int bytes = 0;
+            for (int i = 0; i < REQUESTS_PER_TASK; i++) {
+                try (var loan = pool.borrow()) {
+                    bytes += loan.jq()
+                            .withInput(input)
+                            .withFilter("map(select(.active) | .price) | add")
+                            .withCompactOutput()
+                            .run()
+                            .length;
+                }
+            }
+            return bytes;
+        };
+        tasks = new ArrayList<>(threads);
+        for (int i = 0; i < threads; i++) {
+            tasks.add(task);
+        }
+    }
+
+    @TearDown(Level.Trial)
+    public void tearDown() {
+        executor.shutdownNow();
+        pool.close();
+    }
+
+    @Benchmark
+    public int round(Requests counter) throws InterruptedException, ExecutionException {
+        int bytes = 0;
+        for (Future<Integer> result : executor.invokeAll(tasks)) {
+            bytes += result.get();
+        }
+        counter.requests += (long) threads * REQUESTS_PER_TASK;
+        return bytes;
+    }
+}
@@ -0,0 +1,44 @@
+package io.roastedroot.jq4j.benchmarks;
+
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Deterministic JSON payloads for the benchmarks: a top-level array of
+ * small records, grown until it reaches the requested size.
+ */
+final class Payloads {
+
+    private Payloads() {}
+
+    /**
+     * Parses sizes such as {@code 1KB}, {@code 64KB} or {@code 100MB}.
+     */
+    static int parseSize(String size) {
+        if (size.endsWith("MB")) {
+            return Integer.parseInt(size.substring(0, size.length() - 2)) * 1024 * 1024;
+        }
+        if (size.endsWith("KB")) {
+            return Integer.parseInt(size.substring(0, size.length() - 2)) * 1024;
+        }
+        return Integer.parseInt(size);
+    }
+
+    static byte[] array(int targetBytes) {
+        var json = new StringBuilder(targetBytes + 256);
+        json.append('[');
+        for (int i = 0; json.length() < targetBytes; i++) {
+            if (i > 0) {
+                json.append(',');
+            }
+            json.append("{\"id\":").append(i)
+                    .append(",\"name\":\"item-").append(i).append('"')
+                    .append(",\"group\":\"g").append(i % 16).append('"')
+                    .append(",\"price\":").append(i % 1000).append('.').append(i % 100)
+                    .append(",\"active\":").append(i % 3 != 0)
+                    .append(",\"tags\":[\"t").append(i % 7).append("\",\"t").append(i % 5)
+                    .append("\"]}");
+        }
+        json.append(']');
+        return json.toString().getBytes(StandardCharsets.UTF_8);
+    }
+}
@@ -0,0 +1,84 @@
+package io.roastedroot.jq4j.benchmarks;
+
+import io.roastedroot.jq4j.JqReactor;
+import java.nio.charset.StandardCharsets;
+import java.util.concurrent.TimeUnit;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Level;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+
+/**
+ * Per-call cost of {@link JqReactor#process} on a warm reactor, across
+ * payload sizes and filter shapes.  {@code textFilter} goes through the
+ * filter cache, {@code compiledFilter} through a precompiled handle.
+ *
+ * <p>The larger sizes take seconds per call; narrow them down with
+ * {@code -p size=1KB,64KB} when iterating locally.
+ */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(value = 1, jvmArgsAppend = "-Xmx6g")
+@State(Scope.Thread)
+public class ProcessBenchmark {
+
+    public enum Filter {
+        IDENTITY("."),
+        ITERATE(".[]"),
+        MAP_SELECT("map(select(.active and .price > 100) | .name)"),
+        GROUP_BY("group_by(.group) | map({group: .[0].group, n: length})"),
+        REGEX("map(select(.name | test(\"item-[0-9]*7$\")))");
+
+        private final String program;
+
+        Filter(String program) {
+            this.program = program;
+        }
+    }
+
+    @Param({"1KB", "64KB", "1MB", "10MB", "100MB"})
+    public String size;
+
+    @Param
+    public Filter filter;
+
+    private JqReactor reactor;
+    private JqReactor.CompiledFilter compiled;
+    private byte[] input;
+    private byte[] program;
+
+    @Setup(Level.Trial)
+    public void setUp() {
+        reactor = JqReactor.build().reactor();
+        input = Payloads.array(Payloads.parseSize(size));
+        program = filter.program.getBytes(StandardCharsets.UTF_8);
+        compiled = reactor.compile(program);
+    }
+
+    @TearDown(Level.Trial)
+    public void tearDown() {
+        compiled.close();
+        reactor.close();
+    }
+
+    @Benchmark
+    public byte[] textFilter() {
+        return reactor.process(input, program, JqReactor.FLAG_COMPACT);
+    }
+
+    @Benchmark
+    public byte[] compiledFilter() {
+        return reactor.process(input, compiled, JqReactor.FLAG_COMPACT);
+    }
+}
@@ -0,0 +1,47 @@
+package io.roastedroot.jq4j.benchmarks;
+
+import io.roastedroot.jq4j.Jq;
+import io.roastedroot.jq4j.JqReactor;
+import io.roastedroot.jq4j.JqResult;
+import java.nio.charset.StandardCharsets;
+import java.util.concurrent.TimeUnit;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Warmup;
+
+/**
+ * What a caller pays before the first result: a full command-mode
+ * {@link Jq} run, and instantiating a {@link JqReactor}.
+ */
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MILLISECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class StartupBenchmark {
+
+    private static final byte[] INPUT = "{\"a\":1}".getBytes(StandardCharsets.UTF_8);
+
+    @Benchmark
+    public JqResult jqCommand() {
+        return Jq.builder().withStdin(INPUT).withArgs("-c", ".a").run();
+    }
+
+    @Benchmark
+    public JqReactor.Builder reactorBuild() {
+        var jq = JqReactor.build();
+        jq.close();
+        return jq;
+    }
+
+    @Benchmark
+    public byte[] reactorFirstCall() {
+        try (var jq = JqReactor.build()) {
+            return jq.withInput(INPUT).withFilter(".a").withCompactOutput().run();
+        }
+    }
+}
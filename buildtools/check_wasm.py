@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+Checks that wasm/jq.wasm was built from the current buildtools/Dockerfile:
+every function the link exports, and the jq4j host import, must be in the
+committed module.  Jq_ModuleExports is generated from that module, so a
+stale binary otherwise only shows up as Java compile errors.
+
+Needs nothing but python3, unlike `make build`.
+"""
+
+import re
+import sys
+
+DOCKERFILE = "buildtools/Dockerfile"
+IMPORTS = {("jq4j", "emit_result")}
+
+
+def leb128(data, pos):
+    result = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return result, pos
+
+
+def name(data, pos):
+    length, pos = leb128(data, pos)
+    return data[pos:pos + length].decode(), pos + length
+
+
+def read_module(path):
+    data = open(path, "rb").read()
+    if data[:4] != b"\0asm":
+        sys.exit(path + " is not a wasm module")
+    imports, exports = set(), set()
+    pos = 8
+    while pos < len(data):
+        section = data[pos]
+        size, pos = leb128(data, pos + 1)
+        end = pos + size
+        if section == 2:
+            count, p = leb128(data, pos)
+            for _ in range(count):
+                module, p = name(data, p)
+                field, p = name(data, p)
+                kind = data[p]
+                p += 1
+                if kind != 0:
+                    break  # only function imports come before memory here
+                _, p = leb128(data, p)
+                imports.add((module, field))
+        elif section == 7:
+            count, p = leb128(data, pos)
+            for _ in range(count):
+                field, p = name(data, p)
+                _, p = leb128(data, p + 1)
+                exports.add(field)
+        pos = end
+    return imports, exports
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "wasm/jq.wasm"
+    wanted = set(re.findall(r"--export=(\w+)", open(DOCKERFILE).read()))
+    imports, exports = read_module(path)
+
+    missing = sorted(wanted - exports)
+    missing += sorted(m + "." + f + " (import)" for m, f in IMPORTS - imports)
+    if missing:
+        print(path + " is older than " + DOCKERFILE + "; run `make build` and commit it.")
+        print("missing: " + ", ".join(missing))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -2,16 +2,34 @@
  * jq_wrapper.c - Thin wrapper over jq's C library API for WASM reactor mode.
  *
  * Mirrors the flow in jq's main.c but reads/writes linear memory
- * instead of stdin/stdout.  Compiled with -mexec-model=reactor and
- * optionally pre-initialised with Wizer.
+ * instead of stdin/stdout.  Compiled with -mexec-model=reactor.
+ *
+ * Not pre-initialised with Wizer: the wasm32-wasi-threads build uses a
+ * shared memory, which Wizer cannot snapshot, and _initialize only runs
+ * jq_init() anyway.  jq binds and compiles its builtin library inside
+ * every jq_compile(), so the expensive part is amortised by the filter
+ * cache and compiled handles below rather than by a startup snapshot.
  *
  * The jq_state is created once (in a constructor) and reused.
+ * Filters can also be compiled ahead of time into their own jq_state
+ * (see compile_filter) and run repeatedly without recompiling, and
+ * process() keeps a small LRU of compiled programs keyed by filter.
  */
 
+#define _GNU_SOURCE                /* fopencookie */
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>                /* malloc_usable_size */
+#include <time.h>
+#include <unistd.h>                /* sbrk */
 #include <wasi/api.h>
 #include "jv.h"
+#include "jv_dtoa.h"               /* jq's own number formatting */
 #include "jq.h"
 
 /* ── jq_main bridge: fetch WASI args and forward to jq_main ─────── */
@@ -42,10 +60,49 @@ int jq_main_wasi(void) {
 #define FLAG_NULL_INPUT (1 << 1)
 #define FLAG_COMPACT    (1 << 2)
 #define FLAG_SORT_KEYS  (1 << 3)
+#define FLAG_EMIT       (1 << 4)   /* set by JqReactor.stream() */
+#define FLAG_CBOR       (1 << 5)
+#define FLAG_PROJECT    (1 << 6)   /* process() only, see projection */
+#define FLAG_STREAM      (1 << 7)  /* --stream */
+#define FLAG_SEQ         (1 << 8)  /* --seq */
+#define FLAG_RAW_INPUT   (1 << 9)  /* --raw-input */
+#define FLAG_RAW_OUTPUT  (1 << 10) /* --raw-output */
+#define FLAG_JOIN_OUTPUT (1 << 11) /* --join-output, implies raw output */
+
+/* ── dumpopts bits above jq's JV_PRINT_* range, read by run_jq ──── */
+#define DUMP_CBOR       (1 << 30)  /* CBOR instead of text */
+#define DUMP_RAW        (1 << 29)  /* strings without quotes */
+#define DUMP_JOIN       (1 << 28)  /* no newline after results */
+#define DUMP_SEQ        (1 << 27)  /* RS before every result */
+
+/* ── run_jq: jq program called halt/halt_error, stop reading input ─ */
+#define RUN_HALTED       1
+
+/* ── error records ──────────────────────────────────────────────── */
+#define ERROR_BUF_SIZE   (16 * 1024)
+#define ERROR_MSG_MAX    1024
+
+/* ── filter cache ───────────────────────────────────────────────── */
+#define DEFAULT_FILTER_CACHE_SIZE 16
+
+/* ── heap stats: must match -Wl,--max-memory in the Dockerfile ──── */
+#define MEMORY_LIMIT_BYTES 4294967296LL
+
+/* ── compact writer: deeper values go through jv_dumpf instead ──── */
+#define COMPACT_MAX_DEPTH 128
 
 /* ── error return codes ─────────────────────────────────────────── */
 #define RC_ERROR_INIT    -3
 #define RC_ERROR_COMPILE -1
+#define RC_ERROR_RUNTIME -2    /* output produced, see get_errors() */
+#define RC_ERROR_OUTPUT  -4
+#define RC_ERROR_SESSION -5
+#define RC_ERROR_ARGS    -6    /* set_args: not a JSON object */
+#define RC_ERROR_TIMEOUT -7    /* the host set the interrupt flag */
+
+/* session_feed: jq halted or the input failed to parse, the rest of the
+ * input is ignored; the halt_error or parse error is in get_errors() */
+#define RC_SESSION_ENDED 1
 
 /* ── global state ───────────────────────────────────────────────── */
 static jq_state *jq = NULL;
@@ -54,8 +111,67 @@ static char *output_buf = NULL;
 static int   output_len = 0;
 static int   output_cap = 0;
 
+static char *input_buf = NULL;
+static int   input_cap = 0;
+
+/* buffers larger than this are released between calls (0 = keep) */
+static int   buffer_retention = 0;
+
+typedef struct {
+    char      *filter;           /* owned copy + args text, NULL when free */
+    int        filter_len;
+    int        args_len;
+    jq_state  *state;
+    unsigned   last_used;
+} cache_entry;
+
+static cache_entry *filter_cache      = NULL;
+static int          filter_cache_size = 0;
+static unsigned     filter_cache_tick = 0;
+
+/* layout must match JqReactor.filterCacheStats() */
+static struct {
+    int hits;
+    int misses;
+    int evictions;
+} filter_cache_stats;
+
+/* layout must match JqReactor.readErrors() */
+static struct {
+    int  len;                    /* bytes used in data */
+    int  dropped;                /* errors that did not fit */
+    char data[ERROR_BUF_SIZE];   /* (int32 index, int32 len, bytes)* */
+} errors;
+
+/* layout must match JqReactor.lastCallStats(); times stay 0 unless   *
+ * set_stats_enabled(1), since every lap is a WASI clock call          */
+static struct {
+    long long compile_ns;
+    long long parse_ns;
+    long long execute_ns;        /* jq_start/jq_next, incl. `input` parses */
+    long long dump_ns;           /* dump_text/cbor_dump + output_append */
+    long long bytes_in;
+    long long bytes_out;
+    long long results;
+} call_stats;
+
+static int stats_enabled = 0;
+
+/* set to 1 by the host's watchdog thread, cleared by the host */
+static volatile int interrupt_requested = 0;
+
+static int error_total  = 0;     /* errors seen, including dropped */
+static int input_count  = 0;     /* values handed to jq this call */
+static int batch_record = -1;    /* reported index inside process_batch */
+
+int set_filter_cache_size(int size);
+static jq_state *new_state(void);
+
 __attribute__((constructor))
-static void jq_wrapper_init(void) { jq = jq_init(); }
+static void jq_wrapper_init(void) {
+    jq = new_state();
+    set_filter_cache_size(DEFAULT_FILTER_CACHE_SIZE);
+}
 
 /* ── memory helpers ─────────────────────────────────────────────── */
 
@@ -63,14 +179,154 @@ void *alloc(int size) { return malloc((size_t)size); }
 
 void dealloc(void *ptr, int size) { (void)size; free(ptr); }
 
+/* ── heap accounting: malloc and friends wrapped at link time ────── *
+ *                                                                    *
+ * wasi-libc's dlmalloc is built without mallinfo, so the link wraps  *
+ * malloc/calloc/realloc/free and the aligned allocators              *
+ * (-Wl,--wrap) and counts usable bytes here, for jq, oniguruma and   *
+ * this wrapper alike.  memalign/valloc are not wrapped: wasi-libc    *
+ * only exports the standard aligned_alloc and posix_memalign.        *
+ * get_heap_stats adds the heap size dlmalloc has taken from sbrk,    *
+ * which never shrinks.                                              */
+
+extern unsigned char __heap_base;
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t count, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+extern void  __real_free(void *ptr);
+extern void *__real_aligned_alloc(size_t alignment, size_t size);
+extern int   __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+
+static long long heap_in_use = 0;
+static long long heap_peak   = 0;
+
+static void heap_account(long long delta) {
+    heap_in_use += delta;
+    if (heap_in_use > heap_peak) heap_peak = heap_in_use;
+}
+
+void *__wrap_malloc(size_t size) {
+    void *p = __real_malloc(size);
+    if (p) heap_account((long long)malloc_usable_size(p));
+    return p;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    void *p = __real_calloc(count, size);
+    if (p) heap_account((long long)malloc_usable_size(p));
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    long long before = ptr ? (long long)malloc_usable_size(ptr) : 0;
+    void *p = __real_realloc(ptr, size);
+    if (p)
+        heap_account((long long)malloc_usable_size(p) - before);
+    else if (ptr && size == 0)
+        heap_account(-before);             /* realloc(p, 0) freed p */
+    return p;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    void *p = __real_aligned_alloc(alignment, size);
+    if (p) heap_account((long long)malloc_usable_size(p));
+    return p;
+}
+
+int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size) {
+    int rc = __real_posix_memalign(ptr, alignment, size);
+    if (rc == 0 && *ptr) heap_account((long long)malloc_usable_size(*ptr));
+    return rc;
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr) heap_account(-(long long)malloc_usable_size(ptr));
+    __real_free(ptr);
+}
+
+/* layout must match JqReactor.heapStats() */
+static struct {
+    long long memory_bytes;      /* linear memory size now */
+    long long memory_limit;      /* what it may grow to */
+    long long heap_bytes;        /* taken by malloc from sbrk */
+    long long in_use_bytes;      /* live allocations, usable size */
+    long long peak_in_use_bytes;
+    long long output_cap;        /* the wrapper's buffers, included above */
+    long long input_cap;
+} heap_stats;
+
+void *get_heap_stats(void) {
+    uintptr_t base = (uintptr_t)&__heap_base;
+    uintptr_t top  = (uintptr_t)sbrk(0);
+    heap_stats.memory_bytes      = (long long)__builtin_wasm_memory_size(0) * 65536;
+    heap_stats.memory_limit      = MEMORY_LIMIT_BYTES;
+    heap_stats.heap_bytes        = top > base ? (long long)(top - base) : 0;
+    heap_stats.in_use_bytes      = heap_in_use;
+    heap_stats.peak_in_use_bytes = heap_peak;
+    heap_stats.output_cap        = output_cap;
+    heap_stats.input_cap         = input_cap;
+    return &heap_stats;
+}
+
+/* ── staging buffer: host writes inputs/filters here ────────────── *
+ *                                                                    *
+ * Grow-only and reused across calls, so a long-lived reactor does    *
+ * not malloc/free a fresh input and filter buffer for every request. *
+ * The previous contents are not preserved when it grows.             */
+
+char *get_input_buf(int min_size) {
+    if (buffer_retention && input_cap > buffer_retention
+            && min_size <= buffer_retention) {
+        free(input_buf);
+        input_buf = NULL;
+        input_cap = 0;
+    }
+    if (!input_buf || min_size > input_cap) {
+        int new_cap = input_cap ? input_cap : 4096;
+        while (new_cap < min_size)
+            new_cap = new_cap > INT_MAX / 2 ? min_size : new_cap * 2;
+        free(input_buf);
+        input_buf = malloc(new_cap);
+        input_cap = input_buf ? new_cap : 0;
+    }
+    return input_buf;
+}
+
 /* host reads the output after process() returns */
 char *get_output_ptr(void) { return output_buf; }
 int   get_output_len(void) { return output_len; }
 
+/* ── host import: per-result streaming callback ─────────────────── *
+ *                                                                    *
+ * With FLAG_EMIT every result is handed to the host as soon as jq    *
+ * produces it, instead of accumulating in output_buf.  A non-zero    *
+ * return asks the guest to stop producing results.                   */
+
+__attribute__((import_module("jq4j"), import_name("emit_result")))
+extern int emit_result(const char *ptr, int len);
+
 /* ── growable output buffer ─────────────────────────────────────── */
 
 static void output_reset(void) { output_len = 0; }
 
+/* ── retention cap: give outlier-sized buffers back to the heap ──── *
+ *                                                                    *
+ * Both buffers only ever grow while in use.  With a retention cap,   *
+ * one that grew past it for a single large call is released before  *
+ * the next call (the host has read the output by then), so a long-   *
+ * lived reactor's buffers track typical payloads, not the worst one. */
+
+void set_buffer_retention(int bytes) { buffer_retention = bytes > 0 ? bytes : 0; }
+
+static void output_begin(void) {
+    if (buffer_retention && output_cap > buffer_retention) {
+        free(output_buf);
+        output_buf = NULL;
+        output_cap = 0;
+    }
+    output_reset();
+}
+
 static int output_append(const char *s, int slen) {
     int needed = output_len + slen;
     if (needed > output_cap) {
@@ -86,6 +342,390 @@ static int output_append(const char *s, int slen) {
     return 0;
 }
 
+/* ── output_file: unbuffered FILE that appends to output_buf ────── *
+ *                                                                    *
+ * jv_dumpf writes every token straight through output_append, so no  *
+ * intermediate jv string is built for each result.                   */
+
+static FILE *output_file = NULL;
+
+static ssize_t output_file_write(void *cookie, const char *buf, size_t size) {
+    (void)cookie;
+    return output_append(buf, (int)size) < 0 ? -1 : (ssize_t)size;
+}
+
+static FILE *output_stream(void) {
+    if (!output_file) {
+        cookie_io_functions_t io = { NULL, output_file_write, NULL, NULL };
+        output_file = fopencookie(NULL, "w", io);
+        if (output_file) setvbuf(output_file, NULL, _IONBF, 0);
+    }
+    return output_file;
+}
+
+/* ── CBOR output: results as an RFC 8742 CBOR sequence ───────────── *
+ *                                                                    *
+ * Written straight from the jv tree into output_buf, so callers that *
+ * would re-parse jq's text output skip both the dump and the parse.  *
+ * Numbers that are integral and exact in a double become CBOR ints,  *
+ * everything else a float64; NaN and infinities are mapped the way   *
+ * jv_dump prints them (null, +-DBL_MAX).                             */
+
+static int cbor_head(int major, unsigned long long arg) {
+    unsigned char b[9];
+    int n;
+    if (arg < 24) {
+        b[0] = (unsigned char)(major << 5 | arg);
+        n = 1;
+    } else if (arg <= 0xff) {
+        b[0] = (unsigned char)(major << 5 | 24);
+        n = 2;
+    } else if (arg <= 0xffff) {
+        b[0] = (unsigned char)(major << 5 | 25);
+        n = 3;
+    } else if (arg <= 0xffffffffULL) {
+        b[0] = (unsigned char)(major << 5 | 26);
+        n = 5;
+    } else {
+        b[0] = (unsigned char)(major << 5 | 27);
+        n = 9;
+    }
+    for (int i = n - 1; i > 0; i--, arg >>= 8)
+        b[i] = (unsigned char)arg;
+    return output_append((const char *)b, n);
+}
+
+static int cbor_number(double d) {
+    if (isnan(d)) return output_append("\xf6", 1);
+    if (isinf(d)) d = d > 0 ? DBL_MAX : -DBL_MAX;
+    if (d == floor(d) && fabs(d) <= 9007199254740992.0 && !(d == 0 && signbit(d))) {
+        long long i = (long long)d;
+        return i >= 0 ? cbor_head(0, (unsigned long long)i)
+                      : cbor_head(1, (unsigned long long)(-1 - i));
+    }
+    unsigned long long bits;
+    memcpy(&bits, &d, sizeof bits);
+    unsigned char b[9] = { 0xfb };
+    for (int i = 8; i > 0; i--, bits >>= 8)
+        b[i] = (unsigned char)bits;
+    return output_append((const char *)b, 9);
+}
+
+static int cbor_string(jv s) {                      /* consumes s */
+    int len = jv_string_length_bytes(jv_copy(s));
+    int rc = cbor_head(3, (unsigned long long)len);
+    if (rc == 0) rc = output_append(jv_string_value(s), len);
+    jv_free(s);
+    return rc;
+}
+
+static int cbor_dump(jv v, int sorted) {            /* consumes v */
+    int rc = 0;
+    switch (jv_get_kind(v)) {
+    case JV_KIND_NULL:   rc = output_append("\xf6", 1); break;
+    case JV_KIND_FALSE:  rc = output_append("\xf4", 1); break;
+    case JV_KIND_TRUE:   rc = output_append("\xf5", 1); break;
+    case JV_KIND_NUMBER: rc = cbor_number(jv_number_value(v)); break;
+    case JV_KIND_STRING:
+        return cbor_string(v);
+    case JV_KIND_ARRAY: {
+        int len = jv_array_length(jv_copy(v));
+        rc = cbor_head(4, (unsigned long long)len);
+        for (int i = 0; rc == 0 && i < len; i++)
+            rc = cbor_dump(jv_array_get(jv_copy(v), i), sorted);
+        break;
+    }
+    case JV_KIND_OBJECT:
+        rc = cbor_head(5, (unsigned long long)jv_object_length(jv_copy(v)));
+        if (sorted) {
+            jv keys = jv_keys(jv_copy(v));
+            int len = jv_array_length(jv_copy(keys));
+            for (int i = 0; rc == 0 && i < len; i++) {
+                jv key = jv_array_get(jv_copy(keys), i);
+                jv value = jv_object_get(jv_copy(v), jv_copy(key));
+                rc = cbor_string(key);
+                if (rc == 0) rc = cbor_dump(value, sorted);
+                else jv_free(value);
+            }
+            jv_free(keys);
+        } else {
+            jv_object_foreach(v, key, value) {
+                if (rc == 0) rc = cbor_string(key);
+                else jv_free(key);
+                if (rc == 0) rc = cbor_dump(value, sorted);
+                else jv_free(value);
+            }
+        }
+        break;
+    default:
+        rc = -1;
+        break;
+    }
+    jv_free(v);
+    return rc;
+}
+
+/* ── compact text output: jv_dumpf's output without its machinery ── *
+ *                                                                    *
+ * Compact results are most of the traffic, and jv_dumpf walks them   *
+ * through colour, indent and per-codepoint escape handling, one      *
+ * stdio write per token.  This writer produces the same bytes        *
+ * straight into output_buf: string runs that need no escaping are    *
+ * copied whole, number literals kept from the input are copied as    *
+ * they are, and small integers skip dtoa.  Everything else uses the  *
+ * same jq functions jv_dumpf would.  Values nested deeper than       *
+ * COMPACT_MAX_DEPTH are left to jv_dumpf, which applies jq's own     *
+ * depth limit.                                                       */
+
+#define COMPACT_TOO_DEEP 1
+
+/* bytes jvp_dump_string escapes; UTF-8 sequences are copied as is */
+static const char compact_escape[256] = {
+    ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r',
+    [0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u', [0x04] = 'u',
+    [0x05] = 'u', [0x06] = 'u', [0x07] = 'u', [0x0b] = 'u', [0x0e] = 'u',
+    [0x0f] = 'u', [0x10] = 'u', [0x11] = 'u', [0x12] = 'u', [0x13] = 'u',
+    [0x14] = 'u', [0x15] = 'u', [0x16] = 'u', [0x17] = 'u', [0x18] = 'u',
+    [0x19] = 'u', [0x1a] = 'u', [0x1b] = 'u', [0x1c] = 'u', [0x1d] = 'u',
+    [0x1e] = 'u', [0x1f] = 'u', [0x7f] = 'u',
+    ['"'] = '"', ['\\'] = '\\',
+};
+
+static struct dtoa_context compact_dtoa;
+static int compact_dtoa_ready = 0;
+
+static int compact_string(jv s) {                   /* borrows s */
+    const char *str = jv_string_value(s);
+    int len = jv_string_length_bytes(jv_copy(s));
+    if (output_append("\"", 1) < 0) return -1;
+    int run = 0;
+    for (int i = 0; i < len; i++) {
+        char e = compact_escape[(unsigned char)str[i]];
+        if (!e) continue;
+        char esc[8] = { '\\', e };
+        int n = 2;
+        if (e == 'u')
+            n = snprintf(esc, sizeof esc, "\\u%04x", (unsigned char)str[i]);
+        if (output_append(str + run, i - run) < 0 || output_append(esc, n) < 0)
+            return -1;
+        run = i + 1;
+    }
+    if (output_append(str + run, len - run) < 0) return -1;
+    return output_append("\"", 1);
+}
+
+static int compact_number(jv n) {                   /* borrows n */
+    const char *literal = jv_number_get_literal(n);
+    if (literal) return output_append(literal, (int)strlen(literal));
+
+    double d = jv_number_value(n);
+    if (d != d) return output_append("null", 4);
+    char buf[JVP_DTOA_FMT_MAX_LEN];
+    /* integers below 1e15 print as plain digits in jvp_dtoa_fmt too */
+    if (d == floor(d) && fabs(d) < 1e15 && !(d == 0 && signbit(d))) {
+        long long i = (long long)d;
+        unsigned long long u = i < 0 ? (unsigned long long)-i : (unsigned long long)i;
+        char *p = buf + sizeof buf;
+        do {
+            *--p = (char)('0' + u % 10);
+            u /= 10;
+        } while (u);
+        if (i < 0) *--p = '-';
+        return output_append(p, (int)(buf + sizeof buf - p));
+    }
+    if (d > DBL_MAX) d = DBL_MAX;
+    if (d < -DBL_MAX) d = -DBL_MAX;
+    if (!compact_dtoa_ready) {
+        jvp_dtoa_context_init(&compact_dtoa);
+        compact_dtoa_ready = 1;
+    }
+    const char *text = jvp_dtoa_fmt(&compact_dtoa, buf, d);
+    return output_append(text, (int)strlen(text));
+}
+
+/* consumes v; COMPACT_TOO_DEEP leaves a partial value in output_buf */
+static int compact_dump(jv v, int sorted, int depth) {
+    int rc = 0;
+    if (depth > COMPACT_MAX_DEPTH) {
+        jv_free(v);
+        return COMPACT_TOO_DEEP;
+    }
+    switch (jv_get_kind(v)) {
+    case JV_KIND_NULL:   rc = output_append("null", 4); break;
+    case JV_KIND_FALSE:  rc = output_append("false", 5); break;
+    case JV_KIND_TRUE:   rc = output_append("true", 4); break;
+    case JV_KIND_NUMBER: rc = compact_number(v); break;
+    case JV_KIND_STRING: rc = compact_string(v); break;
+    case JV_KIND_ARRAY: {
+        int len = jv_array_length(jv_copy(v));
+        rc = output_append("[", 1);
+        for (int i = 0; rc == 0 && i < len; i++) {
+            if (i) rc = output_append(",", 1);
+            if (rc == 0) rc = compact_dump(jv_array_get(jv_copy(v), i), sorted, depth + 1);
+        }
+        if (rc == 0) rc = output_append("]", 1);
+        break;
+    }
+    case JV_KIND_OBJECT: {
+        int first = 1;
+        rc = output_append("{", 1);
+        if (sorted) {
+            jv keys = jv_keys(jv_copy(v));
+            int len = jv_array_length(jv_copy(keys));
+            for (int i = 0; rc == 0 && i < len; i++) {
+                jv key = jv_array_get(jv_copy(keys), i);
+                if (i) rc = output_append(",", 1);
+                if (rc == 0) rc = compact_string(key);
+                if (rc == 0) rc = output_append(":", 1);
+                if (rc == 0)
+                    rc = compact_dump(jv_object_get(jv_copy(v), jv_copy(key)), sorted, depth + 1);
+                jv_free(key);
+            }
+            jv_free(keys);
+        } else {
+            jv_object_foreach(v, key, value) {
+                if (rc == 0 && !first) rc = output_append(",", 1);
+                if (rc == 0) rc = compact_string(key);
+                if (rc == 0) rc = output_append(":", 1);
+                if (rc == 0) rc = compact_dump(value, sorted, depth + 1);
+                else jv_free(value);
+                jv_free(key);
+                first = 0;
+            }
+        }
+        if (rc == 0) rc = output_append("}", 1);
+        break;
+    }
+    default:
+        rc = -1;
+        break;
+    }
+    jv_free(v);
+    return rc;
+}
+
+/* consumes v; writes it the way jv_dumpf(v, dumpopts) would */
+static int dump_text(jv v, FILE *out, int dumpopts) {
+    if (!(dumpopts & ~JV_PRINT_SORTED)) {
+        int start = output_len;
+        int rc = compact_dump(jv_copy(v), dumpopts & JV_PRINT_SORTED, 0);
+        if (rc != COMPACT_TOO_DEEP) {
+            jv_free(v);
+            return rc;
+        }
+        output_len = start;
+    }
+    jv_dumpf(v, out, dumpopts);
+    if (ferror(out)) {
+        clearerr(out);
+        return -1;
+    }
+    return 0;
+}
+
+/* ── error records: bounded buffer instead of WASI stderr ────────── *
+ *                                                                    *
+ * jq's default error callback prints to stderr, which the host would *
+ * have to keep and scrape forever.  Instead, compile errors (via     *
+ * jq_set_error_cb), uncaught runtime errors from jq_next and input   *
+ * parse errors are appended here as (input index, message) records.  *
+ * The index is -1 for compile errors and the batch record inside     *
+ * process_batch.  Once the buffer is full, errors are only counted.   */
+
+void *get_errors(void) { return &errors; }
+
+static void errors_reset(void) {
+    errors.len     = 0;
+    errors.dropped = 0;
+}
+
+static void record_error(int index, jv msg) {      /* consumes msg */
+    if (jv_get_kind(msg) != JV_KIND_STRING) {
+        jv dumped = jv_dump_string(msg, 0);
+        msg = jv_string_fmt("%s (not a string)", jv_string_value(dumped));
+        jv_free(dumped);
+    }
+    if (batch_record >= 0) index = batch_record;
+
+    int msg_len = jv_string_length_bytes(jv_copy(msg));
+    if (msg_len > ERROR_MSG_MAX) msg_len = ERROR_MSG_MAX;
+
+    error_total++;
+    if (errors.len + 8 + msg_len > ERROR_BUF_SIZE) {
+        errors.dropped++;
+    } else {
+        char *rec = errors.data + errors.len;
+        memcpy(rec, &index, 4);
+        memcpy(rec + 4, &msg_len, 4);
+        memcpy(rec + 8, jv_string_value(msg), msg_len);
+        errors.len += 8 + msg_len;
+    }
+    jv_free(msg);
+}
+
+/* the value jq is running on; null input counts as input 0 */
+static int current_input(void) {
+    return input_count > 0 ? input_count - 1 : 0;
+}
+
+static void error_cb(void *data, jv msg) {
+    (void)data;
+    record_error(-1, jq_format_error(msg));
+}
+
+/* `debug` and `stderr` messages are dropped rather than piling up on
+ * WASI stderr in a long-lived reactor */
+static void drop_msg_cb(void *data, jv msg) {
+    (void)data;
+    jv_free(msg);
+}
+
+static jq_state *new_state(void) {
+    jq_state *state = jq_init();
+    if (state) {
+        jq_set_error_cb(state, error_cb, NULL);
+        jq_set_debug_cb(state, drop_msg_cb, NULL);
+        jq_set_stderr_cb(state, drop_msg_cb, NULL);
+    }
+    return state;
+}
+
+/* ── call stats ─────────────────────────────────────────────────── */
+
+void *get_call_stats(void) { return &call_stats; }
+
+void set_stats_enabled(int enabled) { stats_enabled = enabled != 0; }
+
+static void stats_reset(void) {
+    memset(&call_stats, 0, sizeof(call_stats));
+}
+
+static long long now_ns(void) {
+    if (!stats_enabled) return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* charges the time since *since to *phase and restarts the clock */
+static void stats_lap(long long *since, long long *phase) {
+    if (!stats_enabled) return;
+    long long now = now_ns();
+    *phase += now - *since;
+    *since = now;
+}
+
+/* ── interruption: cooperative stop for calls past their deadline ── *
+ *                                                                    *
+ * The host writes a non-zero value to this word from another thread  *
+ * when a call runs out of time.  run_jq checks it after every result  *
+ * and the input callback before every value, so filters that keep    *
+ * producing results or reading inputs stop with RC_ERROR_TIMEOUT and  *
+ * leave the jq_state reusable.  Filters that spin inside a single     *
+ * jq_next never get here; the host interrupts its thread instead.     */
+
+volatile int *get_interrupt_flag(void) { return &interrupt_requested; }
+
 /* ── buf_input: buffer-backed input, mirrors jq_util_input ──────── *
  *                                                                    *
  * Handles slurp internally (just like jq_util_input_set_parser +     *
@@ -96,113 +736,812 @@ static int output_append(const char *s, int slen) {
  * Also serves as the callback for jq_set_input_cb so the `inputs`    *
  * builtin works.                                                     */
 
+typedef struct projection projection;
+
 typedef struct {
     jv_parser *parser;
     jv         slurped;          /* jv_invalid() when not slurping */
+    int        partial;          /* more buffers will follow (sessions) */
+    const projection *project;   /* non-NULL: values come from project_next */
+    const char *buf;             /* current buffer, for project/raw reads */
+    int         len;
+    int         pos;
+    int         raw;             /* --raw-input: 1 lines, 2 slurp, 3 slurp done */
+    int         seq;             /* --seq: parse errors are not fatal */
+    int         failed;          /* a parse error ended the input */
+    char       *line;            /* raw bytes carried over a buffer end */
+    int         line_len;
+    int         line_cap;
 } buf_input;
 
+static jv project_next(buf_input *bi);
+
+static int parser_flags_for(int flags) {
+    return ((flags & FLAG_STREAM) ? JV_PARSE_STREAMING : 0)
+         | ((flags & FLAG_SEQ) ? JV_PARSE_SEQ : 0);
+}
+
+/*
+ * buf may be NULL for sessions, which set each chunk in session_feed.
+ * Raw input is split by raw_next alone and gets no parser: nothing
+ * would drain it, and jv_parser_set_buf asserts on an undrained buffer.
+ */
 static void buf_input_init(buf_input *bi,
-                           const char *buf, int len, int slurp) {
-    bi->parser  = jv_parser_new(0);
-    jv_parser_set_buf(bi->parser, buf, len, 0);
-    bi->slurped = slurp ? jv_array() : jv_invalid();
+                           const char *buf, int len, int flags) {
+    int slurp = flags & FLAG_SLURP;
+    bi->raw     = (flags & FLAG_RAW_INPUT) ? (slurp ? 2 : 1) : 0;
+    bi->parser  = bi->raw ? NULL : jv_parser_new(parser_flags_for(flags));
+    if (buf && bi->parser) jv_parser_set_buf(bi->parser, buf, len, 0);
+    bi->seq     = (flags & FLAG_SEQ) && !bi->raw;
+    bi->failed  = 0;
+    bi->slurped = slurp && !bi->raw ? jv_array() : jv_invalid();
+    bi->partial = 0;
+    bi->project = NULL;
+    bi->buf     = buf;
+    bi->len     = len;
+    bi->pos     = 0;
+    bi->line     = NULL;
+    bi->line_len = 0;
+    bi->line_cap = 0;
 }
 
-static jv buf_input_next(buf_input *bi) {
+static int raw_line_append(buf_input *bi, const char *s, int n) {
+    if (bi->line_len + n > bi->line_cap) {
+        int cap = bi->line_cap ? bi->line_cap : 256;
+        while (cap < bi->line_len + n) cap *= 2;
+        char *grown = realloc(bi->line, cap);
+        if (!grown) return -1;
+        bi->line = grown;
+        bi->line_cap = cap;
+    }
+    memcpy(bi->line + bi->line_len, s, n);
+    bi->line_len += n;
+    return 0;
+}
+
+/*
+ * --raw-input: every line as a string without its newline, or the whole
+ * input as one string when slurping.  Bytes are carried over buffer ends
+ * unconverted, so a UTF-8 sequence split between chunks stays intact.
+ */
+static jv raw_next(buf_input *bi) {
+    while (bi->pos < bi->len) {
+        const char *start = bi->buf + bi->pos;
+        int left = bi->len - bi->pos;
+        const char *nl = bi->raw == 1 ? memchr(start, '\n', left) : NULL;
+        int n = nl ? (int)(nl - start) : left;
+        bi->pos += nl ? n + 1 : n;
+        if (!nl || bi->line_len) {
+            if (raw_line_append(bi, start, n) < 0)
+                return jv_invalid_with_msg(jv_string("out of memory"));
+            if (!nl) break;
+            start = bi->line;
+            n = bi->line_len;
+        }
+        jv line = jv_string_sized(start, n);
+        bi->line_len = 0;
+        return line;
+    }
+    /* end of this buffer: wait for the next one, or flush what is left */
+    if (bi->partial || bi->raw == 3 || (bi->raw == 1 && !bi->line_len))
+        return jv_invalid();
+
+    jv rest = jv_string_sized(bi->line ? bi->line : "", bi->line_len);
+    bi->line_len = 0;
+    if (bi->raw == 2) bi->raw = 3;                 /* slurped string handed out */
+    return rest;
+}
+
+static jv buf_input_read(buf_input *bi) {
+    if (bi->raw) return raw_next(bi);
+    if (bi->project) return project_next(bi);
+    return jv_parser_next(bi->parser);
+}
+
+static jv buf_input_parse(buf_input *bi) {
     jv value;
-    while (jv_is_valid(value = jv_parser_next(bi->parser))) {
+    for (;;) {
+        value = buf_input_read(bi);
+        if (!jv_is_valid(value)) {
+            /* --seq: like jq, drop the malformed text and resync at the
+             * next RS, which the parser is now waiting for */
+            if (!bi->seq || !jv_invalid_has_msg(jv_copy(value))) break;
+            jv_free(value);
+            continue;
+        }
         if (jv_is_valid(bi->slurped)) {
             bi->slurped = jv_array_append(bi->slurped, value);
             continue;
         }
+        input_count++;
         return value;
     }
-    jv_free(value);
+    if (jv_invalid_has_msg(jv_copy(value))) {
+        record_error(input_count, jv_invalid_get_msg(value));
+        bi->failed = 1;                  /* like jq, stop at the first one */
+    } else {
+        jv_free(value);
+    }
+
+    /* a partial buffer ran dry: the slurped array is not complete yet */
+    if (bi->partial) return jv_invalid();
 
     if (jv_is_valid(bi->slurped)) {
         jv result = bi->slurped;
         bi->slurped = jv_invalid();
+        input_count++;
         return result;
     }
     return jv_invalid();
 }
 
-static jv buf_input_cb(jq_state *jq, void *data) {
-    (void)jq;
+static jv buf_input_next(buf_input *bi) {
+    long long t = now_ns();
+    jv value = buf_input_parse(bi);
+    stats_lap(&t, &call_stats.parse_ns);
+    return value;
+}
+
+static jv buf_input_cb(jq_state *state, void *data) {
+    (void)state;
+    if (interrupt_requested) return jv_invalid();  /* run_jq reports it */
     return buf_input_next((buf_input *)data);
 }
 
 static void buf_input_free(buf_input *bi) {
-    jv_parser_free(bi->parser);
+    free(bi->line);
+    if (bi->parser) jv_parser_free(bi->parser);
     if (jv_is_valid(bi->slurped))
         jv_free(bi->slurped);
 }
 
+/* ── projection: parse only the path a field-access filter reads ─ *
+ *                                                                    *
+ * With FLAG_PROJECT, process() checks whether the filter is a plain   *
+ * chain of object lookups (.a.b["c"]."d", no escapes).  If it is,    *
+ * each top-level input is scanned structurally and only the value at *
+ * that path is parsed; jq then runs the unchanged filter over        *
+ * {"a":{"b":{"c":{"d":<value>}}}}, which yields the same result.     *
+ * Missing keys give {} (jq reads null), and anything that is not an  *
+ * object, or a key with escapes, is parsed in full so jq reports the *
+ * same errors.  Skipped subtrees are not validated: that is the      *
+ * trade-off the caller opts into.                                    */
+
+#define PROJECT_MAX_DEPTH 16
+
+struct projection {
+    int         depth;                       /* 0: filter not projectable */
+    const char *key[PROJECT_MAX_DEPTH];      /* point into the filter text */
+    int         key_len[PROJECT_MAX_DEPTH];
+};
+
+static projection call_projection;
+
+static int is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int skip_ws(const char *buf, int i, int len) {
+    while (i < len && is_ws(buf[i])) i++;
+    return i;
+}
+
+/* index after the closing quote of the string at buf[i], -1 if none */
+static int skip_string(const char *buf, int i, int len) {
+    for (i++; i < len; i++) {
+        if (buf[i] == '\\') i++;
+        else if (buf[i] == '"') return i + 1;
+    }
+    return -1;
+}
+
+/* index just past the value starting at buf[i], -1 if truncated */
+static int skip_value(const char *buf, int i, int len) {
+    if (buf[i] == '"') return skip_string(buf, i, len);
+    if (buf[i] != '{' && buf[i] != '[') {
+        while (i < len && !is_ws(buf[i]) && !strchr(",:]}[{\"", buf[i])) i++;
+        return i;
+    }
+    int depth = 0;
+    while (i < len) {
+        char c = buf[i];
+        if (c == '"') {
+            i = skip_string(buf, i, len);
+            if (i < 0) return -1;
+            continue;
+        }
+        if (c == '{' || c == '[') depth++;
+        else if ((c == '}' || c == ']') && --depth == 0) return i + 1;
+        i++;
+    }
+    return -1;
+}
+
+static void projection_parse(projection *pr, const char *f, int len) {
+    pr->depth = 0;
+    int i = skip_ws(f, 0, len);
+    int depth = 0;
+    while (i < len && !is_ws(f[i])) {
+        const char *key;
+        int key_len;
+        if (f[i] == '.' && i + 1 < len && f[i + 1] == '[') {
+            i++;
+        }
+        if (f[i] == '[') {                         /* ["key"] */
+            if (i + 1 >= len || f[i + 1] != '"') return;
+            int end = skip_string(f, i + 1, len);
+            if (end < 0 || end >= len || f[end] != ']') return;
+            key = f + i + 2;
+            key_len = end - i - 3;
+            i = end + 1;
+        } else if (f[i] == '.' && i + 1 < len && f[i + 1] == '"') {  /* ."key" */
+            int end = skip_string(f, i + 1, len);
+            if (end < 0) return;
+            key = f + i + 2;
+            key_len = end - i - 3;
+            i = end;
+        } else if (f[i] == '.') {                  /* .ident */
+            int start = ++i;
+            while (i < len && (f[i] == '_' || (f[i] >= 'a' && f[i] <= 'z')
+                    || (f[i] >= 'A' && f[i] <= 'Z')
+                    || (i > start && f[i] >= '0' && f[i] <= '9')))
+                i++;
+            if (i == start) return;
+            key = f + start;
+            key_len = i - start;
+        } else {
+            return;
+        }
+        if (memchr(key, '\\', key_len) || depth == PROJECT_MAX_DEPTH) return;
+        pr->key[depth] = key;
+        pr->key_len[depth] = key_len;
+        depth++;
+    }
+    if (skip_ws(f, i, len) == len) pr->depth = depth;
+}
+
+/*
+ * one value from a slice; not jv_parse_sized, whose error message
+ * quotes the text with %s and would run past the end of the slice
+ */
+static jv parse_slice(const char *buf, int len) {
+    jv_parser *parser = jv_parser_new(0);
+    jv_parser_set_buf(parser, buf, len, 0);
+    jv value = jv_parser_next(parser);
+    jv_parser_free(parser);
+    if (!jv_is_valid(value) && !jv_invalid_has_msg(jv_copy(value))) {
+        jv_free(value);
+        value = jv_invalid_with_msg(jv_string("Expected JSON value"));
+    }
+    return value;
+}
+
+/* the value in buf[start, end) with everything off the path dropped */
+static jv project_value(const projection *pr, int level,
+                        const char *buf, int start, int end) {
+    if (level == pr->depth || buf[start] != '{')
+        return parse_slice(buf + start, end - start);
+
+    int found_start = -1, found_end = -1;
+    int i = skip_ws(buf, start + 1, end);
+    if (i < end && buf[i] == '}') i = -2;          /* empty object */
+    while (i >= 0) {
+        if (i >= end || buf[i] != '"') goto full;
+        int key_end = skip_string(buf, i, end);
+        if (key_end < 0) goto full;
+        const char *key = buf + i + 1;
+        int key_len = key_end - i - 2;
+        if (memchr(key, '\\', key_len)) goto full;
+        i = skip_ws(buf, key_end, end);
+        if (i >= end || buf[i] != ':') goto full;
+        int value_start = skip_ws(buf, i + 1, end);
+        if (value_start >= end) goto full;
+        int value_end = skip_value(buf, value_start, end);
+        if (value_end <= value_start) goto full;
+        if (key_len == pr->key_len[level]
+                && memcmp(key, pr->key[level], key_len) == 0) {
+            found_start = value_start;             /* last one wins, as in jq */
+            found_end   = value_end;
+        }
+        i = skip_ws(buf, value_end, end);
+        if (i < end && buf[i] == ',') {
+            i = skip_ws(buf, i + 1, end);
+        } else if (i < end && buf[i] == '}' && skip_ws(buf, i + 1, end) == end) {
+            break;
+        } else {
+            goto full;
+        }
+    }
+    if (found_start < 0) return jv_object();
+
+    jv child = project_value(pr, level + 1, buf, found_start, found_end);
+    if (!jv_is_valid(child)) return child;
+    return jv_object_set(jv_object(),
+                         jv_string_sized(pr->key[level], pr->key_len[level]),
+                         child);
+full:
+    return parse_slice(buf + start, end - start);
+}
+
+/* next top-level input, projected; jv_invalid() at the end */
+static jv project_next(buf_input *bi) {
+    /* jv_parser strips a UTF-8 BOM at the start of the input, so must we */
+    if (bi->pos == 0 && bi->len >= 3 && memcmp(bi->buf, "\xEF\xBB\xBF", 3) == 0)
+        bi->pos = 3;
+    int start = skip_ws(bi->buf, bi->pos, bi->len);
+    if (start >= bi->len) {
+        bi->pos = bi->len;
+        return jv_invalid();
+    }
+    int end = skip_value(bi->buf, start, bi->len);
+    if (end <= start) end = bi->len;               /* let jq report it */
+    bi->pos = end;
+    return project_value(bi->project, 0, bi->buf, start, end);
+}
+
 /* ── jq_start/jq_next loop → growable output buffer ────────────── */
 
-static int run_jq(jv input, int dumpopts) {
-    jq_start(jq, input, 0);                       /* consumes input */
+static int run_jq(jq_state *state, jv input, int dumpopts, int emit) {
+    FILE *out = output_stream();
+    if (!out) {
+        jv_free(input);
+        return RC_ERROR_OUTPUT;
+    }
+
+    long long t = now_ns();
+    jq_start(state, input, 0);                    /* consumes input */
     jv result;
-    while (jv_is_valid(result = jq_next(jq))) {
-        jv dumped = jv_dump_string(result, dumpopts);  /* consumes result */
-        const char *s = jv_string_value(dumped);
-        int slen = jv_string_length_bytes(jv_copy(dumped));
-        if (output_append(s, slen) < 0 || output_append("\n", 1) < 0) {
-            jv_free(dumped);
-            jv_free(jq_next(jq)); /* drain */
-            return -1;
+    while (jv_is_valid(result = jq_next(state))) {
+        stats_lap(&t, &call_stats.execute_ns);
+        if (interrupt_requested) {
+            jv_free(result);
+            return RC_ERROR_TIMEOUT;
         }
-        jv_free(dumped);
+        int start = output_len;
+        if (dumpopts & DUMP_CBOR) {
+            if (cbor_dump(result, dumpopts & JV_PRINT_SORTED) < 0)
+                return RC_ERROR_OUTPUT;
+        } else {
+            if ((dumpopts & DUMP_SEQ) && output_append("\x1e", 1) < 0) {
+                jv_free(result);
+                return RC_ERROR_OUTPUT;
+            }
+            if ((dumpopts & DUMP_RAW) && jv_get_kind(result) == JV_KIND_STRING) {
+                int rc = output_append(jv_string_value(result),
+                                       jv_string_length_bytes(jv_copy(result)));
+                jv_free(result);
+                if (rc < 0) return RC_ERROR_OUTPUT;
+            } else if (dump_text(result, out, dumpopts & ~(DUMP_RAW | DUMP_JOIN | DUMP_SEQ)) < 0) {
+                return RC_ERROR_OUTPUT;
+            }
+            if (!emit && !(dumpopts & DUMP_JOIN) && output_append("\n", 1) < 0)
+                return RC_ERROR_OUTPUT;
+        }
+        call_stats.results++;
+        call_stats.bytes_out += output_len - start;
+        stats_lap(&t, &call_stats.dump_ns);
+
+        if (emit) {
+            int stop = emit_result(output_buf, output_len);
+            output_reset();
+            if (stop) return RC_ERROR_OUTPUT;
+            t = now_ns();                          /* host time is not ours */
+        }
+    }
+    stats_lap(&t, &call_stats.execute_ns);
+    if (interrupt_requested) {
+        jv_free(result);
+        return RC_ERROR_TIMEOUT;
     }
-    jv_free(result);
+
+    /* same order as jq main.c process(): halt first, then errors */
+    if (jq_halted(state)) {
+        jv_free(result);
+        jv code = jq_get_exit_code(state);
+        jv msg  = jq_get_error_message(state);
+        int failed = jv_is_valid(code)
+            && !(jv_get_kind(code) == JV_KIND_NUMBER && jv_number_value(code) == 0);
+        jv_free(code);
+        if (failed && (jv_get_kind(msg) == JV_KIND_NULL || !jv_is_valid(msg))) {
+            jv_free(msg);
+            msg = jv_string("halted with an error");
+        }
+        if (failed)
+            record_error(current_input(), msg);
+        else
+            jv_free(msg);
+        return RUN_HALTED;
+    }
+    if (jv_invalid_has_msg(jv_copy(result)))
+        record_error(current_input(), jv_invalid_get_msg(result));
+    else
+        jv_free(result);
     return 0;
 }
 
-/* ── main entry point ───────────────────────────────────────────── *
+/* ── compile: null-terminate the filter and hand it to jq ───────── */
+
+/* ── named arguments: --arg/--argjson for programs compiled next ─── *
  *                                                                    *
- * Returns bytes written to the output buffer (>= 0), or negative     *
- * error code.  Host reads output via get_output_ptr().               */
+ * The host passes one JSON object of name → value; like jq main.c,   *
+ * every name is bound as $name and the object is also available as   *
+ * $ARGS.named.  The text is kept as given and is part of the filter  *
+ * cache key, so a program is never reused with different bindings.   */
 
-int process(
-        const char *input_ptr,  int input_len,
-        const char *filter_ptr, int filter_len,
-        int         flags)
-{
-    if (!jq) return RC_ERROR_INIT;
+static char *args_text = NULL;
+static int   args_len  = 0;
 
-    output_reset();
+int set_args(const char *ptr, int len) {
+    free(args_text);
+    args_text = NULL;
+    args_len  = 0;
+    if (len <= 0) return 0;
+
+    jv parsed = parse_slice(ptr, len);
+    int is_object = jv_get_kind(parsed) == JV_KIND_OBJECT;
+    jv_free(parsed);
+    if (!is_object) return RC_ERROR_ARGS;
 
-    /* null-terminate filter for jq_compile */
+    args_text = malloc(len);
+    if (!args_text) return RC_ERROR_INIT;
+    memcpy(args_text, ptr, len);
+    args_len = len;
+    return 0;
+}
+
+/* the program_arguments object jq main.c hands to jq_compile_args */
+static jv program_args(void) {
+    jv named = args_text ? parse_slice(args_text, args_len) : jv_object();
+    jv args = jv_object();
+    args = jv_object_set(args, jv_string("positional"), jv_array());
+    args = jv_object_set(args, jv_string("named"), jv_copy(named));
+    return jv_object_set(named, jv_string("ARGS"), args);
+}
+
+static int compile_into(jq_state *state,
+                        const char *filter_ptr, int filter_len) {
     char *filter = malloc(filter_len + 1);
     if (!filter) return RC_ERROR_INIT;
     memcpy(filter, filter_ptr, filter_len);
     filter[filter_len] = '\0';
 
-    int ok = jq_compile(jq, filter);
+    int ok = jq_compile_args(state, filter, program_args());
     free(filter);
-    if (!ok) return RC_ERROR_COMPILE;
+    return ok ? 0 : RC_ERROR_COMPILE;
+}
+
+/* ── execute: run an already-compiled state over the input ──────── */
 
+static int dumpopts_for(int flags) {
     int dumpopts = (flags & FLAG_COMPACT)
         ? 0
         : JV_PRINT_INDENT_FLAGS(2);
     if (flags & FLAG_SORT_KEYS)
         dumpopts |= JV_PRINT_SORTED;
+    if (flags & FLAG_CBOR)
+        dumpopts |= DUMP_CBOR;
+    if (flags & (FLAG_RAW_OUTPUT | FLAG_JOIN_OUTPUT))
+        dumpopts |= DUMP_RAW;
+    if (flags & FLAG_JOIN_OUTPUT)
+        dumpopts |= DUMP_JOIN;
+    if (flags & FLAG_SEQ)
+        dumpopts |= DUMP_SEQ;
+    return dumpopts;
+}
+
+/* folds run_jq's result into the entry point's return code */
+static int finish(int rc, int errors_before) {
+    if (rc == RUN_HALTED) rc = 0;
+    if (rc == 0 && error_total > errors_before) rc = RC_ERROR_RUNTIME;
+    return rc;
+}
+
+/* appends to output_buf; callers reset it first */
+static int execute(jq_state *state,
+                   const char *input_ptr, int input_len, int flags) {
+    int dumpopts = dumpopts_for(flags);
+    int errors_before = error_total;
+    input_count = 0;
+    call_stats.bytes_in += input_len;
 
     /* set up buffer input — handles slurp internally */
     buf_input input;
-    buf_input_init(&input, input_ptr, input_len, flags & FLAG_SLURP);
-    jq_set_input_cb(jq, buf_input_cb, &input);
+    buf_input_init(&input, input_ptr, input_len, flags);
+    if (call_projection.depth > 0)
+        input.project = &call_projection;
+    jq_set_input_cb(state, buf_input_cb, &input);
 
     /* two branches, same as jq main.c lines 666-693 */
+    int emit = flags & FLAG_EMIT;
+    int rc = 0;
     if (flags & FLAG_NULL_INPUT) {
-        run_jq(jv_null(), dumpopts);
+        rc = run_jq(state, jv_null(), dumpopts, emit);
     } else {
         jv value;
-        while (jv_is_valid(value = buf_input_next(&input)))
-            run_jq(value, dumpopts);
+        while (rc == 0 && jv_is_valid(value = buf_input_next(&input)))
+            rc = run_jq(state, value, dumpopts, emit);
     }
 
-    jq_set_input_cb(jq, NULL, NULL);
+    jq_set_input_cb(state, NULL, NULL);
     buf_input_free(&input);
+    return finish(rc, errors_before);
+}
+
+/* ── compiled filter handles ────────────────────────────────────── *
+ *                                                                    *
+ * Each handle owns a private jq_state holding one compiled program,  *
+ * so parse/compile/bytecode generation is paid once per filter.      *
+ * The host keeps the returned pointer and passes it to run_compiled  *
+ * for every call, then releases it with free_compiled.               */
+
+static jq_state *compile_program(const char *filter_ptr, int filter_len) {
+    jq_state *state = new_state();
+    if (!state) return NULL;
+    if (compile_into(state, filter_ptr, filter_len) < 0) {
+        jq_teardown(&state);
+        return NULL;
+    }
+    return state;
+}
+
+jq_state *compile_filter(const char *filter_ptr, int filter_len) {
+    errors_reset();
+    return compile_program(filter_ptr, filter_len);
+}
+
+int run_compiled(jq_state *handle,
+                 const char *input_ptr, int input_len,
+                 int flags)
+{
+    if (!handle) return RC_ERROR_INIT;
+    output_begin();
+    errors_reset();
+    stats_reset();
+    return execute(handle, input_ptr, input_len, flags);
+}
+
+/* ── batch: many inputs x one compiled filter per call ──────────── *
+ *                                                                    *
+ * records points at count triples of int32, filled by the host with  *
+ * (input_ptr, input_len, 0).  Each record is run in turn and its     *
+ * triple is overwritten in place with (output_offset, output_len,    *
+ * status), where the offset is relative to get_output_ptr().  A      *
+ * failing record does not stop the rest of the batch.                */
+
+int process_batch(int *records, int count, jq_state *handle, int flags) {
+    if (!handle) return RC_ERROR_INIT;
+
+    output_begin();
+    errors_reset();
+    stats_reset();
+    flags &= ~FLAG_EMIT;
+    for (int i = 0; i < count; i++) {
+        int *rec = &records[i * 3];
+        int start = output_len;
+        batch_record = i;
+        int status = execute(handle, (const char *)(intptr_t)rec[0], rec[1], flags);
+        rec[0] = start;
+        rec[1] = output_len - start;
+        rec[2] = status;
+        if (status == RC_ERROR_TIMEOUT) {
+            batch_record = -1;
+            return RC_ERROR_TIMEOUT;
+        }
+    }
+    batch_record = -1;
+    return 0;
+}
+
+void free_compiled(jq_state *handle) {
+    if (handle) jq_teardown(&handle);
+}
+
+/* ── LRU of compiled programs keyed by filter bytes ─────────────── *
+ *                                                                    *
+ * process() looks the filter up here before compiling.  Each entry   *
+ * owns a jq_state built by compile_filter; the least recently used   *
+ * one is torn down when the cache is full.  Size 0 disables caching  *
+ * and falls back to recompiling into the global jq_state.            */
+
+static void cache_entry_clear(cache_entry *e) {
+    if (e->state) jq_teardown(&e->state);
+    free(e->filter);
+    e->filter     = NULL;
+    e->filter_len = 0;
+    e->args_len   = 0;
+    e->last_used  = 0;
+}
+
+int set_filter_cache_size(int size) {
+    if (size < 0) size = 0;
+    for (int i = 0; i < filter_cache_size; i++)
+        cache_entry_clear(&filter_cache[i]);
+    free(filter_cache);
+    filter_cache      = NULL;
+    filter_cache_size = 0;
+    if (size == 0) return 0;
+
+    filter_cache = calloc((size_t)size, sizeof(cache_entry));
+    if (!filter_cache) return RC_ERROR_INIT;
+    filter_cache_size = size;
+    return 0;
+}
+
+void *get_filter_cache_stats(void) { return &filter_cache_stats; }
+
+static jq_state *filter_cache_get(const char *filter_ptr, int filter_len) {
+    cache_entry *victim = &filter_cache[0];
+    for (int i = 0; i < filter_cache_size; i++) {
+        cache_entry *e = &filter_cache[i];
+        if (e->filter && e->filter_len == filter_len && e->args_len == args_len
+                && memcmp(e->filter, filter_ptr, filter_len) == 0
+                && (!args_len || memcmp(e->filter + filter_len, args_text, args_len) == 0)) {
+            e->last_used = ++filter_cache_tick;
+            filter_cache_stats.hits++;
+            return e->state;
+        }
+        if (!e->filter || (victim->filter && e->last_used < victim->last_used))
+            victim = e;
+    }
+    filter_cache_stats.misses++;
+
+    jq_state *state = compile_program(filter_ptr, filter_len);
+    if (!state) return NULL;
+
+    char *key = malloc(filter_len + args_len ? filter_len + args_len : 1);
+    if (!key) {
+        jq_teardown(&state);
+        return NULL;
+    }
+    memcpy(key, filter_ptr, filter_len);
+    if (args_len) memcpy(key + filter_len, args_text, args_len);
+
+    if (victim->filter) {
+        cache_entry_clear(victim);
+        filter_cache_stats.evictions++;
+    }
+    victim->filter     = key;
+    victim->filter_len = filter_len;
+    victim->args_len   = args_len;
+    victim->state      = state;
+    victim->last_used  = ++filter_cache_tick;
+    return state;
+}
+
+/* ── main entry point ───────────────────────────────────────────── *
+ *                                                                    *
+ * Returns bytes written to the output buffer (>= 0), or negative     *
+ * error code.  Host reads output via get_output_ptr().               */
+
+int process(
+        const char *input_ptr,  int input_len,
+        const char *filter_ptr, int filter_len,
+        int         flags)
+{
+    if (!jq) return RC_ERROR_INIT;
+
+    errors_reset();
+    stats_reset();
+    long long t = now_ns();
+    jq_state *state = jq;
+    if (filter_cache_size > 0) {
+        state = filter_cache_get(filter_ptr, filter_len);
+        if (!state) return RC_ERROR_COMPILE;
+    } else {
+        int rc = compile_into(jq, filter_ptr, filter_len);
+        if (rc < 0) return rc;
+    }
+    stats_lap(&t, &call_stats.compile_ns);
+
+    /* only plain JSON texts can be scanned; buf_input_read would
+     * otherwise prefer project_next over the stream/seq/raw readers */
+    if ((flags & FLAG_PROJECT)
+            && !(flags & (FLAG_SLURP | FLAG_NULL_INPUT | FLAG_STREAM
+                          | FLAG_SEQ | FLAG_RAW_INPUT)))
+        projection_parse(&call_projection, filter_ptr, filter_len);
+
+    output_begin();
+    int rc = execute(state, input_ptr, input_len, flags);
+    call_projection.depth = 0;
+    return rc;
+}
+
+/* ── incremental input sessions ─────────────────────────────────── *
+ *                                                                    *
+ * session_open compiles (or borrows) a program, then session_feed    *
+ * hands the parser one chunk at a time via jv_parser_set_buf's       *
+ * partial-buffer support.  Every value completed by a chunk is run   *
+ * immediately and its output is left in output_buf for the host to   *
+ * drain before the next feed, so neither the input nor the output    *
+ * has to fit in linear memory at once.  The parser copies tokens, so *
+ * the host may reuse the chunk buffer after each feed.                *
+ *                                                                    *
+ * Null input is not supported: `inputs` would have to block on data  *
+ * the host has not fed yet.  One session per reactor at a time.       *
+ *                                                                    *
+ * Once the program halts, or a value fails to parse outside --seq,   *
+ * jq reads no more input: session_feed returns RC_SESSION_ENDED, and *
+ * every later feed does nothing but return it again.  The parser     *
+ * still holds an undrained chunk, or would resume mid-document.      */
+
+static struct {
+    jq_state  *state;
+    int        owns_state;       /* compiled by session_open */
+    buf_input  input;
+    int        flags;
+    int        ended;            /* halted, or the input failed to parse */
+    int        open;
+} session;
+
+int session_close(void);
+
+int session_open(jq_state *compiled,
+                 const char *filter_ptr, int filter_len,
+                 int flags)
+{
+    if (session.open) session_close();
+    if (flags & FLAG_NULL_INPUT) return RC_ERROR_SESSION;
+
+    errors_reset();
+    stats_reset();
+    input_count = 0;
+    jq_state *state = compiled;
+    if (!state) {
+        long long t = now_ns();
+        state = compile_program(filter_ptr, filter_len);
+        stats_lap(&t, &call_stats.compile_ns);
+        if (!state) return RC_ERROR_COMPILE;
+    }
+
+    session.state      = state;
+    session.owns_state = compiled == NULL;
+    session.flags      = flags;
+    session.ended      = 0;
+    buf_input_init(&session.input, NULL, 0, flags);
+    session.input.partial = 1;
+    session.open = 1;
+    return 0;
+}
+
+int session_feed(const char *chunk_ptr, int chunk_len, int is_last) {
+    if (!session.open) return RC_ERROR_SESSION;
+
+    output_begin();
+    errors_reset();
+    if (session.ended) return RC_SESSION_ENDED;
+    int errors_before = error_total;
+    call_stats.bytes_in += chunk_len;      /* summed over the session */
+
+    buf_input *input = &session.input;
+    input->partial = !is_last;
+    input->buf = chunk_ptr;
+    input->len = chunk_len;
+    input->pos = 0;
+    if (input->parser)
+        jv_parser_set_buf(input->parser, chunk_ptr, chunk_len, !is_last);
+    jq_set_input_cb(session.state, buf_input_cb, input);
+
+    int dumpopts = dumpopts_for(session.flags);
+    int emit = session.flags & FLAG_EMIT;
+    int rc = 0;
+    jv value;
+    while (rc == 0 && jv_is_valid(value = buf_input_next(input)))
+        rc = run_jq(session.state, value, dumpopts, emit);
+
+    jq_set_input_cb(session.state, NULL, NULL);
+    if (rc == RUN_HALTED || input->failed) {
+        session.ended = 1;
+        return RC_SESSION_ENDED;
+    }
+    return finish(rc, errors_before);
+}
+
+int session_close(void) {
+    if (!session.open) return RC_ERROR_SESSION;
+
+    buf_input_free(&session.input);
+    if (session.owns_state) jq_teardown(&session.state);
+    session.state = NULL;
+    session.open  = 0;
     return 0;
 }
@@ -45,6 +45,7 @@ public final class Jq {
                                 ImportValues.builder()
                                         .addFunction(wasi.toHostFunctions())
                                         .addFunction(threadSpawnStub())
+                                        .addFunction(emitResultStub())
                                         .build())
                         .build();
                 var exports = new Jq_ModuleExports(instance);
@@ -73,6 +74,19 @@ public final class Jq {
                 });
     }
 
+    protected static HostFunction emitResultStub() {
+        return new HostFunction(
+                "jq4j",
+                "emit_result",
+                FunctionType.of(
+                        List.of(ValType.I32, ValType.I32),
+                        List.of(ValType.I32)),
+                (i, a) -> {
+                    throw new UnsupportedOperationException(
+                            "emit_result is only available in reactor mode");
+                });
+    }
+
     public static final class Builder {
         private byte[] stdin;
         private List<String> args;
@@ -0,0 +1,67 @@
+package io.roastedroot.jq4j;
+
+import jdk.jfr.Category;
+import jdk.jfr.DataAmount;
+import jdk.jfr.Description;
+import jdk.jfr.Event;
+import jdk.jfr.Label;
+import jdk.jfr.Name;
+import jdk.jfr.Timespan;
+
+/**
+ * JFR view of {@link JqReactor.CallStats}, committed after every reactor
+ * call while the event is enabled in a recording.
+ */
+@Name("io.roastedroot.jq4j.Call")
+@Label("jq Call")
+@Category("jq4j")
+@Description("One JqReactor call, split into guest and boundary phases")
+final class JqCallEvent extends Event {
+
+    @Label("Compile")
+    @Timespan(Timespan.NANOSECONDS)
+    long compile;
+
+    @Label("Parse")
+    @Timespan(Timespan.NANOSECONDS)
+    long parse;
+
+    @Label("Execute")
+    @Timespan(Timespan.NANOSECONDS)
+    long execute;
+
+    @Label("Dump")
+    @Timespan(Timespan.NANOSECONDS)
+    long dump;
+
+    @Label("Copy In")
+    @Timespan(Timespan.NANOSECONDS)
+    long copyIn;
+
+    @Label("Copy Out")
+    @Timespan(Timespan.NANOSECONDS)
+    long copyOut;
+
+    @Label("Bytes In")
+    @DataAmount
+    long bytesIn;
+
+    @Label("Bytes Out")
+    @DataAmount
+    long bytesOut;
+
+    @Label("Results")
+    long results;
+
+    void record(JqReactor.CallStats stats) {
+        compile = stats.compileNanos();
+        parse = stats.parseNanos();
+        execute = stats.executeNanos();
+        dump = stats.dumpNanos();
+        copyIn = stats.copyInNanos();
+        copyOut = stats.copyOutNanos();
+        bytesIn = stats.bytesIn();
+        bytesOut = stats.bytesOut();
+        results = stats.results();
+    }
+}
@@ -0,0 +1,149 @@
+package io.roastedroot.jq4j;
+
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.function.Consumer;
+
+/**
+ * Decodes the output of a {@link JqReactor#FLAG_CBOR} call into plain
+ * Java values, one per jq result.
+ *
+ * <p>JSON maps to {@code null}, {@link Boolean}, {@link Long} (integral
+ * numbers), {@link Double}, {@link String}, {@link List} and
+ * {@link Map} (keys in jq's output order).  The output is a standard
+ * RFC 8742 CBOR sequence, so it can equally be read with any CBOR
+ * library, e.g. Jackson's {@code CBORFactory} to get a {@code JsonNode}.
+ */
+public final class JqCbor {
+
+    private final byte[] buf;
+    private int pos;
+
+    private JqCbor(byte[] buf) {
+        this.buf = buf;
+    }
+
+    /** Decodes every result in {@code output}. */
+    public static List<Object> decode(byte[] output) {
+        var results = new ArrayList<>();
+        decode(output, results::add);
+        return results;
+    }
+
+    /** Hands every result in {@code output} to {@code consumer} as it is decoded. */
+    public static void decode(byte[] output, Consumer<Object> consumer) {
+        var decoder = new JqCbor(output);
+        while (decoder.pos < output.length) {
+            consumer.accept(decoder.next());
+        }
+    }
+
+    private Object next() {
+        int initial = readByte();
+        int major = initial >>> 5;
+        int info = initial & 0x1f;
+        switch (major) {
+            case 0:
+                return argument(info);
+            case 1:
+                return -1 - argument(info);
+            case 3: {
+                int len = length(info);
+                String s = new String(buf, pos, len, StandardCharsets.UTF_8);
+                pos += len;
+                return s;
+            }
+            case 4: {
+                int len = length(info);
+                var list = new ArrayList<>(len);
+                for (int i = 0; i < len; i++) {
+                    list.add(next());
+                }
+                return list;
+            }
+            case 5: {
+                int len = length(info);
+                var map = new LinkedHashMap<String, Object>(len * 4 / 3 + 1);
+                for (int i = 0; i < len; i++) {
+                    Object key = next();
+                    if (!(key instanceof String)) {
+                        throw malformed("non-string key");
+                    }
+                    map.put((String) key, next());
+                }
+                return map;
+            }
+            case 7:
+                return simple(info);
+            default:
+                throw malformed("unsupported major type " + major);
+        }
+    }
+
+    private Object simple(int info) {
+        switch (info) {
+            case 20:
+                return Boolean.FALSE;
+            case 21:
+                return Boolean.TRUE;
+            case 22:
+                return null;
+            case 27:
+                return Double.longBitsToDouble(readBigEndian(8));
+            default:
+                throw malformed("unsupported simple value " + info);
+        }
+    }
+
+    private long argument(int info) {
+        if (info < 24) {
+            return info;
+        }
+        switch (info) {
+            case 24:
+                return readBigEndian(1);
+            case 25:
+                return readBigEndian(2);
+            case 26:
+                return readBigEndian(4);
+            case 27:
+                long value = readBigEndian(8);
+                if (value < 0) {
+                    throw malformed("integer out of range");
+                }
+                return value;
+            default:
+                throw malformed("unsupported length encoding " + info);
+        }
+    }
+
+    private int length(int info) {
+        long len = argument(info);
+        if (len > buf.length - pos) {
+            throw malformed("length " + len + " past the end of the output");
+        }
+        return (int) len;
+    }
+
+    private long readBigEndian(int bytes) {
+        long value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value = value << 8 | readByte();
+        }
+        return value;
+    }
+
+    private int readByte() {
+        if (pos >= buf.length) {
+            throw malformed("truncated output");
+        }
+        return buf[pos++] & 0xff;
+    }
+
+    private IllegalArgumentException malformed(String what) {
+        return new IllegalArgumentException("Malformed CBOR at offset " + pos + ": " + what);
+    }
+}
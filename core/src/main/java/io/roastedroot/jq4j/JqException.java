@@ -0,0 +1,85 @@
+package io.roastedroot.jq4j;
+
+import java.util.List;
+
+/**
+ * Errors reported by jq itself: a filter that does not compile, an
+ * uncaught runtime error, or input that is not valid JSON.
+ *
+ * <p>Every error carries the index of the input value it belongs to, so
+ * callers do not have to parse jq's stderr.  Inputs that did not fail
+ * still produce output; {@link #output()} holds it when the call would
+ * have returned it as a {@code byte[]}.
+ */
+public final class JqException extends RuntimeException {
+
+    private static final long serialVersionUID = 1L;
+
+    private final transient List<ErrorRecord> errors;
+    private final int droppedErrors;
+    private final byte[] output;
+
+    JqException(String message, List<ErrorRecord> errors, int droppedErrors, byte[] output) {
+        super(message);
+        this.errors = List.copyOf(errors);
+        this.droppedErrors = droppedErrors;
+        this.output = output;
+    }
+
+    /**
+     * The recorded errors, in the order jq reported them.
+     */
+    public List<ErrorRecord> errors() {
+        return errors;
+    }
+
+    /**
+     * Errors that did not fit in the guest's error buffer and were only
+     * counted.
+     */
+    public int droppedErrors() {
+        return droppedErrors;
+    }
+
+    /**
+     * Output produced by the inputs that did not fail; empty when it was
+     * already written to a stream or consumer.
+     */
+    public byte[] output() {
+        return output.clone();
+    }
+
+    /**
+     * One error as reported by the guest.
+     */
+    public static final class ErrorRecord {
+        /** Index used for errors that do not belong to an input. */
+        public static final int NO_INPUT = -1;
+
+        private final int inputIndex;
+        private final String message;
+
+        ErrorRecord(int inputIndex, String message) {
+            this.inputIndex = inputIndex;
+            this.message = message;
+        }
+
+        /**
+         * Zero-based index of the input value, the record index for
+         * {@link JqReactor#processBatch}, or {@link #NO_INPUT} for
+         * compile errors.
+         */
+        public int inputIndex() {
+            return inputIndex;
+        }
+
+        public String message() {
+            return message;
+        }
+
+        @Override
+        public String toString() {
+            return "ErrorRecord{inputIndex=" + inputIndex + ", message=" + message + "}";
+        }
+    }
+}
@@ -2,6 +2,7 @@ package io.roastedroot.jq4j;
 
 import run.endive.runtime.ByteArrayMemory;
 import run.endive.runtime.ExportFunction;
+import run.endive.runtime.GlobalInstance;
 import run.endive.runtime.HostFunction;
 import run.endive.runtime.ImportValues;
 import run.endive.runtime.Instance;
@@ -10,14 +11,37 @@ import run.endive.wasi.WasiOptions;
 import run.endive.wasi.WasiPreview1;
 import run.endive.wasm.WasmModule;
 import run.endive.wasm.types.FunctionType;
+import run.endive.wasm.types.MemoryLimits;
+import run.endive.wasm.types.MutabilityType;
 import run.endive.wasm.types.ValType;
 
+import java.io.ByteArrayInputStream;
 import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
 import java.io.IOException;
+import java.io.InputStream;
 import java.io.OutputStream;
+import java.io.UncheckedIOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.Channels;
+import java.nio.channels.ReadableByteChannel;
 import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.time.Duration;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.LinkedHashMap;
 import java.util.List;
+import java.util.Map;
 import java.util.Objects;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.ScheduledThreadPoolExecutor;
+import java.util.concurrent.TimeUnit;
+import java.util.function.Consumer;
+import java.util.function.Function;
 
 /**
  * Reactor-mode jq wrapper that uses WASM linear memory for I/O.
@@ -32,13 +56,75 @@ public final class JqReactor implements AutoCloseable {
     public static final int FLAG_NULL_INPUT = 1 << 1;
     public static final int FLAG_COMPACT    = 1 << 2;
     public static final int FLAG_SORT_KEYS  = 1 << 3;
+    private static final int FLAG_EMIT      = 1 << 4;
+    /** Results as a CBOR sequence instead of JSON text; see {@link JqCbor}. */
+    public static final int FLAG_CBOR       = 1 << 5;
+    /**
+     * For text filters that are a plain chain of field lookups such as
+     * {@code .request.headers["x-id"]}, parse only that path of every
+     * input.  Other filters run as usual.  Skipped parts of the input are
+     * not validated.  Ignored by compiled filters, streamed input,
+     * slurp and null-input, and when combined with {@link #FLAG_STREAM},
+     * {@link #FLAG_SEQ} or {@link #FLAG_RAW_INPUT}, whose inputs are not
+     * plain JSON texts.
+     */
+    public static final int FLAG_PROJECT    = 1 << 6;
+    /** jq's {@code --stream}: inputs as [path, leaf] events. */
+    public static final int FLAG_STREAM      = 1 << 7;
+    /**
+     * jq's {@code --seq}: RS-separated input and output (RFC 7464).  As in
+     * jq, a malformed text is skipped up to the next RS rather than
+     * failing the call.
+     */
+    public static final int FLAG_SEQ         = 1 << 8;
+    /** jq's {@code --raw-input}: every line is a string input. */
+    public static final int FLAG_RAW_INPUT   = 1 << 9;
+    /** jq's {@code --raw-output}: string results without quotes. */
+    public static final int FLAG_RAW_OUTPUT  = 1 << 10;
+    /** jq's {@code --join-output}: raw output without newlines. */
+    public static final int FLAG_JOIN_OUTPUT = 1 << 11;
 
     /* ── return codes from the C side ──────────────────────────────── */
     private static final int RC_ERROR_INIT    = -3;
     private static final int RC_ERROR_COMPILE = -1;
+    private static final int RC_ERROR_RUNTIME = -2;
+    private static final int RC_ERROR_OUTPUT  = -4;
+    private static final int RC_ERROR_SESSION = -5;
+    private static final int RC_ERROR_ARGS    = -6;
+    private static final int RC_ERROR_TIMEOUT = -7;
+    private static final int RC_SESSION_ENDED = 1;
+
+    /* ── output is copied to streams in chunks of this size ────────── */
+    private static final int OUTPUT_CHUNK_SIZE = 64 * 1024;
+
+    /* ── streamed input is fed to the guest in chunks of this size ──── */
+    private static final int INPUT_CHUNK_SIZE = 64 * 1024;
+
+    /* ── process_batch record: (ptr|offset, len, status) as int32 ────── */
+    private static final int BATCH_RECORD_SIZE = 12;
+
+    private static final byte[] NO_OUTPUT = new byte[0];
+
+    /* ── call_stats in jq_wrapper.c: seven int64 counters ──────────── */
+    private static final int CALL_STATS_SIZE = 7 * 8;
+
+    /* ── heap_stats in jq_wrapper.c: seven int64 fields ────────────── */
+    private static final int HEAP_STATS_SIZE = 7 * 8;
+
+    /* ── past its deadline, a call gets this long to stop on its own ── */
+    private static final long INTERRUPT_GRACE_NANOS = TimeUnit.MILLISECONDS.toNanos(20);
+
+    /* ── fork() and snapshot() copy linear memory in slices of this size ── */
+    private static final int WASM_PAGE_SIZE = 64 * 1024;
+    private static final int FORK_COPY_PAGES = 256;
+
+    /* ── snapshot() blob header: "JQ4S" and format version ──────────── */
+    private static final int SNAPSHOT_MAGIC = 0x4a513453;
+    private static final int SNAPSHOT_VERSION = 1;
 
     private static WasmModule MODULE = JqModule.load();
 
+    private final Function<MemoryLimits, Memory> memoryFactory;
     private final Instance instance;
     private final WasiPreview1 wasi;
     private final Jq_ModuleExports exports;
@@ -46,7 +132,25 @@ public final class JqReactor implements AutoCloseable {
     private final ByteArrayOutputStream stdout = new ByteArrayOutputStream();
     private final ByteArrayOutputStream stderr = new ByteArrayOutputStream();
 
-    private JqReactor() {
+    /* ── per-result sink while a stream() call is running ────────────── */
+    private Consumer<byte[]> sink;
+    private RuntimeException sinkFailure;
+
+    /* ── boundary-copy time of the current call, see lastCallStats() ── */
+    private long copyInNanos;
+    private long copyOutNanos;
+    private Consumer<CallStats> statsListener;
+
+    /* ── named arguments currently bound in the guest, see setNamedArgs ── */
+    private String namedArgs;
+
+    /* ── see setTimeout(); interrupted: guest abandoned mid-call ─────── */
+    private Duration timeout;
+    private boolean interrupted;
+
+    /* initialize == false: the caller copies a guest state in instead */
+    private JqReactor(Function<MemoryLimits, Memory> memoryFactory, boolean initialize) {
+        this.memoryFactory = memoryFactory;
         this.wasi = WasiPreview1.builder()
                 .withOptions(WasiOptions.builder()
                         .withStdout(stdout)
@@ -56,52 +160,982 @@ public final class JqReactor implements AutoCloseable {
 
         this.instance = Instance.builder(MODULE)
                 .withMachineFactory(JqModule::create)
-                .withMemoryFactory(ByteArrayMemory::new)
+                .withMemoryFactory(memoryFactory)
                 .withImportValues(
                         ImportValues.builder()
                                 .addFunction(wasi.toHostFunctions())
+                                // one instance, one thread: the guest never spawns
                                 .addFunction(Jq.threadSpawnStub())
+                                .addFunction(emitResult())
                                 .build())
                 .build();
 
         this.exports = new Jq_ModuleExports(instance);
 
-        exports._initialize();
+        if (initialize) {
+            exports._initialize();
+        }
+    }
+
+    /**
+     * Creates a new reactor whose guest starts as a copy of this one's:
+     * the linear memory is bulk-copied and the mutable globals (stack
+     * pointer, TLS base) are carried over, so neither jq's initialisation
+     * nor the instantiation-time data copy is repeated.  The copy keeps
+     * this reactor's settings and its filter cache, so filters this
+     * reactor has run before start compiled.  {@link CompiledFilter}
+     * handles stay bound to this reactor.
+     *
+     * <p>This reactor must not run calls while it is being forked;
+     * several forks may be taken from it concurrently.
+     */
+    public JqReactor fork() {
+        ensureUsable();
+        var copy = new JqReactor(memoryFactory, false);
+        copy.copyGuestState(this);
+        copy.statsListener = statsListener;
+        copy.namedArgs = namedArgs;
+        copy.timeout = timeout;
+        return copy;
+    }
+
+    /**
+     * Serialises this reactor's guest state, the way {@link #fork()}
+     * copies it, into a blob that {@link #restore(byte[])} turns back
+     * into a reactor in this or another JVM.  Filters in the filter
+     * cache stay compiled, so a snapshot taken after
+     * {@link #warmFilterCache(String...)} lets a fleet skip both jq's
+     * initialisation and its compiler at startup.  All-zero pages are
+     * left out.
+     *
+     * <p>A snapshot only fits the jq4j version (and jq.wasm) that took
+     * it.  {@link CompiledFilter} handles and the stats listener are not
+     * part of it.  This reactor must not run calls meanwhile.
+     */
+    public byte[] snapshot() {
+        ensureUsable();
+        var bytes = new ByteArrayOutputStream();
+        try (var out = new DataOutputStream(bytes)) {
+            out.writeInt(SNAPSHOT_MAGIC);
+            out.writeInt(SNAPSHOT_VERSION);
+
+            int globals = MODULE.globalSection().globalCount();
+            out.writeInt(globals);
+            for (int i = 0; i < globals; i++) {
+                out.writeLong(instance.global(i).getValue());
+            }
+
+            byte[] args = namedArgs == null ? NO_OUTPUT : namedArgs.getBytes(StandardCharsets.UTF_8);
+            out.writeInt(namedArgs == null ? -1 : args.length);
+            out.write(args);
+
+            Memory memory = instance.memory();
+            int pages = memory.pages();
+            out.writeInt(pages);
+            for (int page = 0; page < pages; page += FORK_COPY_PAGES) {
+                int count = Math.min(FORK_COPY_PAGES, pages - page);
+                byte[] slice = memory.readBytes(page * WASM_PAGE_SIZE, count * WASM_PAGE_SIZE);
+                for (int i = 0; i < count; i++) {
+                    if (!isZero(slice, i * WASM_PAGE_SIZE, WASM_PAGE_SIZE)) {
+                        out.writeInt(page + i);
+                        out.write(slice, i * WASM_PAGE_SIZE, WASM_PAGE_SIZE);
+                    }
+                }
+            }
+            out.writeInt(-1);
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+        return bytes.toByteArray();
+    }
+
+    /**
+     * Compiles {@code filters} into the filter cache without running
+     * them, e.g. on a template before {@link #fork()} or
+     * {@link #snapshot()}.
+     *
+     * @throws JqException if a filter does not compile
+     */
+    public void warmFilterCache(String... filters) {
+        for (String filter : filters) {
+            process(NO_OUTPUT, filter.getBytes(StandardCharsets.UTF_8), 0);
+        }
+    }
+
+    private void copyGuestState(JqReactor template) {
+        Memory from = template.instance.memory();
+        Memory to = instance.memory();
+        int pages = from.pages();
+        if (pages > to.pages() && to.grow(pages - to.pages()) < 0) {
+            throw new RuntimeException("jq fork failed: cannot grow memory to " + pages + " pages");
+        }
+        for (int page = 0; page < pages; page += FORK_COPY_PAGES) {
+            int offset = page * WASM_PAGE_SIZE;
+            int length = Math.min(FORK_COPY_PAGES, pages - page) * WASM_PAGE_SIZE;
+            to.write(offset, from.readBytes(offset, length));
+        }
+
+        int globals = MODULE.globalSection().globalCount();
+        for (int i = 0; i < globals; i++) {
+            GlobalInstance global = instance.global(i);
+            if (global.getMutabilityType() == MutabilityType.Var) {
+                global.setValue(template.instance.global(i).getValue());
+            }
+        }
+    }
+
+    private void restoreGuestState(byte[] snapshot) {
+        try (var in = new DataInputStream(new ByteArrayInputStream(snapshot))) {
+            if (in.readInt() != SNAPSHOT_MAGIC || in.readInt() != SNAPSHOT_VERSION) {
+                throw new IllegalArgumentException("Not a jq4j reactor snapshot");
+            }
+            int globals = MODULE.globalSection().globalCount();
+            if (in.readInt() != globals) {
+                throw new IllegalArgumentException("Snapshot was taken with a different jq module");
+            }
+            for (int i = 0; i < globals; i++) {
+                GlobalInstance global = instance.global(i);
+                long value = in.readLong();
+                if (global.getMutabilityType() == MutabilityType.Var) {
+                    global.setValue(value);
+                } else if (global.getValue() != value) {
+                    throw new IllegalArgumentException("Snapshot was taken with a different jq module");
+                }
+            }
+
+            int argsLength = in.readInt();
+            if (argsLength >= 0) {
+                byte[] args = new byte[argsLength];
+                in.readFully(args);
+                namedArgs = new String(args, StandardCharsets.UTF_8);
+            }
+
+            Memory memory = instance.memory();
+            int initialPages = memory.pages();
+            int pages = in.readInt();
+            if (pages > initialPages && memory.grow(pages - initialPages) < 0) {
+                throw new RuntimeException("jq restore failed: cannot grow memory to " + pages + " pages");
+            }
+            // pages left out were zero; only the instantiation-time data can differ
+            byte[] page = new byte[WASM_PAGE_SIZE];
+            int next = 0;
+            for (int index = in.readInt(); ; index = in.readInt()) {
+                int stop = index < 0 ? Math.min(initialPages, pages) : Math.min(index, initialPages);
+                for (; next < stop; next++) {
+                    byte[] fresh = memory.readBytes(next * WASM_PAGE_SIZE, WASM_PAGE_SIZE);
+                    if (!isZero(fresh, 0, WASM_PAGE_SIZE)) {
+                        memory.write(next * WASM_PAGE_SIZE, new byte[WASM_PAGE_SIZE]);
+                    }
+                }
+                if (index < 0) {
+                    break;
+                }
+                in.readFully(page);
+                memory.write(index * WASM_PAGE_SIZE, page);
+                next = index + 1;
+            }
+        } catch (IOException e) {
+            throw new IllegalArgumentException("Truncated jq4j reactor snapshot", e);
+        }
+    }
+
+    private static boolean isZero(byte[] data, int offset, int length) {
+        for (int i = offset; i < offset + length; i++) {
+            if (data[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private HostFunction emitResult() {
+        return new HostFunction(
+                "jq4j",
+                "emit_result",
+                FunctionType.of(
+                        List.of(ValType.I32, ValType.I32),
+                        List.of(ValType.I32)),
+                (inst, args) -> {
+                    byte[] result = inst.memory().readBytes((int) args[0], (int) args[1]);
+                    try {
+                        sink.accept(result);
+                        return new long[] {0};
+                    } catch (RuntimeException e) {
+                        // let the guest unwind cleanly, rethrown by endStream()
+                        sinkFailure = e;
+                        return new long[] {1};
+                    }
+                });
     }
 
     /**
      * Run a jq filter against the given JSON input.
+     *
+     * @throws JqException if the filter does not compile, or any input
+     *                     fails to parse or raises an uncaught error
      */
     public byte[] process(byte[] input, byte[] filter, int flags) {
-        int inputPtr  = exports.alloc(input.length);
-        int filterPtr = exports.alloc(filter.length);
+        int ret = invoke(input, filter, flags);
+        byte[] output = output();
+        endCall();
+        failOnErrors(ret, output);
+        return output;
+    }
+
+    /**
+     * Run a jq filter and copy the output straight from linear memory
+     * into {@code out}, in bounded chunks, without materialising the
+     * whole result as a single {@code byte[]} on the heap.
+     */
+    public void process(byte[] input, byte[] filter, int flags, OutputStream out) {
+        int ret = invoke(input, filter, flags);
+        writeOutput(out);
+        endCall();
+        failOnErrors(ret, NO_OUTPUT);
+    }
+
+    /**
+     * Run a previously {@linkplain #compile(byte[]) compiled} filter
+     * against the given JSON input.  Only the input crosses into the
+     * guest; the program is not parsed or compiled again.
+     */
+    public byte[] process(byte[] input, CompiledFilter filter, int flags) {
+        int ret = invoke(input, filter, flags);
+        byte[] output = output();
+        endCall();
+        failOnErrors(ret, output);
+        return output;
+    }
+
+    public void process(byte[] input, CompiledFilter filter, int flags, OutputStream out) {
+        int ret = invoke(input, filter, flags);
+        writeOutput(out);
+        endCall();
+        failOnErrors(ret, NO_OUTPUT);
+    }
+
+    /**
+     * Run a compiled filter over many small inputs in a single guest
+     * call.  All inputs are packed into one guest buffer and every
+     * output is read back with one copy, so the Java/WASM boundary is
+     * crossed a constant number of times regardless of batch size.
+     *
+     * @return one output per input, in the same order
+     * @throws JqException if any input fails; error indices are positions
+     *                     in {@code inputs}
+     */
+    public List<byte[]> processBatch(List<byte[]> inputs, CompiledFilter filter) {
+        return processBatch(inputs, filter, 0);
+    }
+
+    public List<byte[]> processBatch(List<byte[]> inputs, CompiledFilter filter, int flags) {
+        int handle = filter.handleFor(this);
+        int count = inputs.size();
+        if (count == 0) {
+            return List.of();
+        }
+        beginCall();
+
+        // records first (int32 aligned), then the input bytes
+        int recordsLen = count * BATCH_RECORD_SIZE;
+        int total = recordsLen;
+        for (byte[] input : inputs) {
+            total += input.length;
+        }
+        int recordsPtr = staging(total);
+        byte[] packed = new byte[total];
+        var records = ByteBuffer.wrap(packed).order(ByteOrder.LITTLE_ENDIAN);
+
+        int off = recordsLen;
+        for (byte[] input : inputs) {
+            records.putInt(recordsPtr + off).putInt(input.length).putInt(0);
+            System.arraycopy(input, 0, packed, off, input.length);
+            off += input.length;
+        }
+        copyIn(recordsPtr, packed);
+
+        int batchRet;
+        var deadline = arm();
+        try {
+            batchRet = exports.processBatch(recordsPtr, count, handle, flags);
+        } catch (RuntimeException e) {
+            throw abandoned(deadline, e);
+        } finally {
+            disarm(deadline);
+        }
+        checkResult(batchRet, filter.source());
+
+        var results = ByteBuffer.wrap(copyOut(recordsPtr, recordsLen))
+                .order(ByteOrder.LITTLE_ENDIAN);
+        byte[] output = output();
+        List<byte[]> outputs = new ArrayList<>(count);
+        int ret = 0;
+        for (int i = 0; i < count; i++) {
+            int outOff = results.getInt();
+            int outLen = results.getInt();
+            if (checkResult(results.getInt(), filter.source()) != 0) {
+                ret = RC_ERROR_RUNTIME;
+            }
+            outputs.add(Arrays.copyOfRange(output, outOff, outOff + outLen));
+        }
+        endCall();
+        failOnErrors(ret, output);
+        return outputs;
+    }
+
+    /**
+     * Run a jq filter over an input stream of unbounded size, feeding
+     * it to the guest in fixed-size chunks.  Each complete top-level
+     * value is processed as soon as it has been read and its output is
+     * written to {@code out} before the next chunk, so working memory is
+     * constant for NDJSON-style inputs.
+     *
+     * <p>{@link #FLAG_NULL_INPUT} is not supported here, and the
+     * {@code input}/{@code inputs} builtins only see values that are
+     * complete within the chunk currently being processed.  Once the
+     * filter calls {@code halt} or {@code halt_error}, or a value fails
+     * to parse (outside {@link #FLAG_SEQ}), no more of {@code input} is
+     * read.
+     */
+    public void process(InputStream input, byte[] filter, int flags, OutputStream out) {
+        runSession(input, 0, filter, flags, out);
+    }
+
+    public void process(InputStream input, CompiledFilter filter, int flags, OutputStream out) {
+        runSession(input, filter.handleFor(this), filter.source(), flags, out);
+    }
+
+    public void process(
+            ReadableByteChannel input, byte[] filter, int flags, OutputStream out) {
+        process(Channels.newInputStream(input), filter, flags, out);
+    }
+
+    /**
+     * Like {@link #process(InputStream, byte[], int, OutputStream)}, reading
+     * the file in chunks: neither the JVM heap nor the guest ever holds the
+     * whole file, only the values currently being processed.
+     */
+    public void process(Path input, byte[] filter, int flags, OutputStream out) {
+        try (var in = Files.newInputStream(input)) {
+            process(in, filter, flags, out);
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+    }
+
+    public void process(Path input, CompiledFilter filter, int flags, OutputStream out) {
+        try (var in = Files.newInputStream(input)) {
+            process(in, filter, flags, out);
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+    }
+
+    /**
+     * Run a jq filter and hand each result to {@code consumer} as soon
+     * as jq produces it, without the trailing newline.  The guest only
+     * ever holds one result, so peak memory and first-result latency do
+     * not depend on the total output size.
+     *
+     * <p>If {@code consumer} throws, jq stops producing results and the
+     * exception is rethrown to the caller.
+     */
+    public void stream(byte[] input, byte[] filter, int flags, Consumer<byte[]> consumer) {
+        beginStream(consumer);
+        try {
+            int ret = invoke(input, filter, flags | FLAG_EMIT);
+            endStream();
+            endCall();
+            failOnErrors(ret, NO_OUTPUT);
+        } finally {
+            endStream();
+        }
+    }
 
+    public void stream(
+            byte[] input, CompiledFilter filter, int flags, Consumer<byte[]> consumer) {
+        beginStream(consumer);
         try {
-            exports.memory().write(inputPtr, input);
-            exports.memory().write(filterPtr, filter);
+            int ret = invoke(input, filter, flags | FLAG_EMIT);
+            endStream();
+            endCall();
+            failOnErrors(ret, NO_OUTPUT);
+        } finally {
+            endStream();
+        }
+    }
+
+    private void beginStream(Consumer<byte[]> consumer) {
+        this.sink = Objects.requireNonNull(consumer);
+        this.sinkFailure = null;
+    }
 
-            int ret = exports.process(inputPtr, input.length, filterPtr, filter.length, flags);
+    /* idempotent: called again from finally after a normal return */
+    private void endStream() {
+        var failure = sinkFailure;
+        sink = null;
+        sinkFailure = null;
+        if (failure != null) {
+            throw failure;
+        }
+    }
 
-            switch (ret) {
-                case 0:
-                    return exports.memory().readBytes(exports.getOutputPtr(), exports.getOutputLen());
-                case RC_ERROR_INIT:
-                    throw new RuntimeException("jq runtime initialization failed");
-                case RC_ERROR_COMPILE:
-                    throw new RuntimeException("jq filter compilation failed: " + filter);
-                default:
-                    throw new RuntimeException("Unknown error from jq wrapper: " + ret);
+    private void runSession(
+            InputStream input, int handle, byte[] filter, int flags, OutputStream out) {
+        if ((flags & FLAG_NULL_INPUT) != 0) {
+            throw new IllegalArgumentException("FLAG_NULL_INPUT is not supported for streamed input");
+        }
+
+        beginCall();
+        openSession(handle, filter, flags);
+        // the guest clears its error buffer on every feed, keep them here
+        List<JqException.ErrorRecord> errors = new ArrayList<>();
+        int dropped = 0;
+        // only time spent in the guest counts: reading the caller's stream
+        // is neither timed nor interrupted
+        long budget = timeout == null ? 0 : timeout.toNanos();
+        try {
+            int chunkPtr = staging(INPUT_CHUNK_SIZE);
+            byte[] chunk = new byte[INPUT_CHUNK_SIZE];
+            boolean last = false;
+            while (!last) {
+                int n = input.readNBytes(chunk, 0, chunk.length);
+                last = n < chunk.length;
+
+                copyIn(chunkPtr, last ? Arrays.copyOf(chunk, n) : chunk);
+                if (timeout != null && budget <= 0) {
+                    throw new JqTimeoutException(timeout, false, null);
+                }
+                int ret;
+                long started = System.nanoTime();
+                var deadline = timeout == null ? null : new Deadline(budget);
+                try {
+                    ret = exports.sessionFeed(chunkPtr, n, last ? 1 : 0);
+                } catch (RuntimeException e) {
+                    throw abandoned(deadline, e);
+                } finally {
+                    disarm(deadline);
+                }
+                budget -= System.nanoTime() - started;
+                // a halt_error or parse error leaves its message with this code
+                boolean ended = ret == RC_SESSION_ENDED;
+                if (ended || checkResult(ret, filter) != 0) {
+                    dropped += readErrors(errors);
+                }
+                writeOutput(out);
+                if (ended) {
+                    // like the jq CLI, ignore the rest of the input
+                    break;
+                }
+            }
+            endCall();
+            if (!errors.isEmpty() || dropped > 0) {
+                throw failure("jq failed", errors, dropped, NO_OUTPUT);
             }
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
         } finally {
-            exports.dealloc(inputPtr, input.length);
-            exports.dealloc(filterPtr, filter.length);
+            if (!interrupted) {
+                exports.sessionClose();
+            }
         }
     }
 
+    private void openSession(int handle, byte[] filter, int flags) {
+        if (handle != 0) {
+            checkResult(exports.sessionOpen(handle, 0, 0, flags), filter);
+            return;
+        }
+
+        int filterPtr = staging(filter.length);
+        copyIn(filterPtr, filter);
+        checkResult(exports.sessionOpen(0, filterPtr, filter.length, flags), filter);
+    }
+
+    private int invoke(byte[] input, byte[] filter, int flags) {
+        beginCall();
+        // input and filter share the staging buffer, back to back
+        int inputPtr  = staging(input.length + filter.length);
+        int filterPtr = inputPtr + input.length;
+
+        copyIn(inputPtr, input);
+        copyIn(filterPtr, filter);
+
+        int ret;
+        var deadline = arm();
+        try {
+            ret = exports.process(inputPtr, input.length, filterPtr, filter.length, flags);
+        } catch (RuntimeException e) {
+            throw abandoned(deadline, e);
+        } finally {
+            disarm(deadline);
+        }
+        return checkResult(ret, filter);
+    }
+
+    private int invoke(byte[] input, CompiledFilter filter, int flags) {
+        int handle = filter.handleFor(this);
+        beginCall();
+        int inputPtr = staging(input.length);
+
+        copyIn(inputPtr, input);
+
+        int ret;
+        var deadline = arm();
+        try {
+            ret = exports.runCompiled(handle, inputPtr, input.length, flags);
+        } catch (RuntimeException e) {
+            throw abandoned(deadline, e);
+        } finally {
+            disarm(deadline);
+        }
+        return checkResult(ret, filter.source());
+    }
+
+    /**
+     * Returns the guest's grow-only staging buffer, at least {@code size}
+     * bytes long.  Valid until the next call that stages data.
+     */
+    private int staging(int size) {
+        int ptr = exports.getInputBuf(size);
+        if (ptr == 0) {
+            throw new RuntimeException("jq input buffer allocation failed: " + size + " bytes");
+        }
+        return ptr;
+    }
+
+    /**
+     * Compile a jq filter once so it can be run repeatedly through
+     * {@link #process(byte[], CompiledFilter, int)}.
+     *
+     * <p>The returned handle is bound to this reactor and should be
+     * {@linkplain CompiledFilter#close() closed} when no longer needed.
+     */
+    public CompiledFilter compile(String filter) {
+        return compile(filter.getBytes(StandardCharsets.UTF_8));
+    }
+
+    public CompiledFilter compile(byte[] filter) {
+        ensureUsable();
+        int filterPtr = staging(filter.length);
+        exports.memory().write(filterPtr, filter);
+
+        int handle = exports.compileFilter(filterPtr, filter.length);
+        if (handle == 0) {
+            throw compileFailure(filter);
+        }
+        return new CompiledFilter(this, handle, filter.clone());
+    }
+
+    /**
+     * Throws for every failure except {@code RC_ERROR_RUNTIME}, which is
+     * returned so the caller can collect the output first and then
+     * report it through {@link #failOnErrors}.
+     */
+    private int checkResult(int ret, byte[] filter) {
+        switch (ret) {
+            case 0:
+            case RC_ERROR_RUNTIME:
+                return ret;
+            case RC_ERROR_INIT:
+                throw new RuntimeException("jq runtime initialization failed");
+            case RC_ERROR_COMPILE:
+                throw compileFailure(filter);
+            case RC_ERROR_OUTPUT:
+                throw new RuntimeException("jq output could not be written");
+            case RC_ERROR_SESSION:
+                throw new IllegalStateException("jq input session is not open or not supported");
+            case RC_ERROR_TIMEOUT:
+                throw new JqTimeoutException(timeout, false, null);
+            default:
+                throw new RuntimeException("Unknown error from jq wrapper: " + ret);
+        }
+    }
+
+    private void failOnErrors(int ret, byte[] output) {
+        if (ret == 0) {
+            return;
+        }
+        List<JqException.ErrorRecord> errors = new ArrayList<>();
+        int dropped = readErrors(errors);
+        throw failure("jq failed", errors, dropped, output);
+    }
+
+    private JqException compileFailure(byte[] filter) {
+        List<JqException.ErrorRecord> errors = new ArrayList<>();
+        int dropped = readErrors(errors);
+        return failure("jq filter compilation failed: " + describe(filter), errors, dropped, NO_OUTPUT);
+    }
+
+    /**
+     * Appends the guest's error records to {@code into}; layout must match
+     * {@code errors} in jq_wrapper.c.
+     *
+     * @return the number of errors that did not fit in the guest buffer
+     */
+    private int readErrors(List<JqException.ErrorRecord> into) {
+        int ptr = exports.getErrors();
+        var memory = exports.memory();
+        int len = memory.readInt(ptr);
+        int dropped = memory.readInt(ptr + 4);
+
+        var data = ByteBuffer.wrap(memory.readBytes(ptr + 8, len)).order(ByteOrder.LITTLE_ENDIAN);
+        while (data.hasRemaining()) {
+            int index = data.getInt();
+            byte[] message = new byte[data.getInt()];
+            data.get(message);
+            into.add(new JqException.ErrorRecord(index, describe(message)));
+        }
+        return dropped;
+    }
+
+    static JqException failure(
+            String what, List<JqException.ErrorRecord> errors, int dropped, byte[] output) {
+        var message = new StringBuilder(what);
+        if (!errors.isEmpty()) {
+            message.append(": ").append(errors.get(0).message());
+        }
+        int more = errors.size() + dropped - 1;
+        if (more > 0) {
+            message.append(" (and ").append(more).append(" more)");
+        }
+        return new JqException(message.toString(), errors, dropped, output);
+    }
+
+    private byte[] output() {
+        return copyOut(exports.getOutputPtr(), exports.getOutputLen());
+    }
+
+    private void writeOutput(OutputStream out) {
+        int ptr = exports.getOutputPtr();
+        int len = exports.getOutputLen();
+        try {
+            for (int off = 0; off < len; off += OUTPUT_CHUNK_SIZE) {
+                out.write(copyOut(ptr + off, Math.min(OUTPUT_CHUNK_SIZE, len - off)));
+            }
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+    }
+
+    /* ── Java/WASM boundary copies, timed for CallStats ────────────── */
+
+    private void copyIn(int ptr, byte[] data) {
+        long start = System.nanoTime();
+        exports.memory().write(ptr, data);
+        copyInNanos += System.nanoTime() - start;
+    }
+
+    private byte[] copyOut(int ptr, int len) {
+        long start = System.nanoTime();
+        byte[] data = exports.memory().readBytes(ptr, len);
+        copyOutNanos += System.nanoTime() - start;
+        return data;
+    }
+
+    private void beginCall() {
+        ensureUsable();
+        stderr.reset();
+        copyInNanos = 0;
+        copyOutNanos = 0;
+    }
+
+    private void endCall() {
+        var event = new JqCallEvent();
+        if (statsListener == null && !event.isEnabled()) {
+            return;
+        }
+        var stats = lastCallStats();
+        if (statsListener != null) {
+            statsListener.accept(stats);
+        }
+        if (event.shouldCommit()) {
+            event.record(stats);
+            event.commit();
+        }
+    }
+
+    /* ── timeouts: a watchdog per guest call, see setTimeout() ─────── */
+
+    /**
+     * Bounds every following call on this reactor to {@code timeout};
+     * {@code null} (the default) removes the bound.
+     *
+     * <p>At the deadline the guest is asked to stop, which it checks
+     * after every result and before every input value, and the call
+     * throws {@link JqTimeoutException} with the reactor intact.  A
+     * filter that spins without producing results, such as
+     * {@code last(repeat(.))} or a pathological regex, is given a short
+     * grace period and then has its thread interrupted.  The guest is
+     * abandoned mid-instruction in that case: the exception reports
+     * {@link JqTimeoutException#reactorDiscarded()}, every further call
+     * throws {@link IllegalStateException}, and {@link JqReactorPool}
+     * replaces the reactor when its loan is returned.
+     *
+     * <p>For streamed input the timeout bounds the time spent in jq over
+     * the whole stream; time spent waiting for the stream itself is not
+     * counted.
+     */
+    public void setTimeout(Duration timeout) {
+        if (timeout != null && (timeout.isNegative() || timeout.isZero())) {
+            throw new IllegalArgumentException("timeout must be positive: " + timeout);
+        }
+        this.timeout = timeout;
+    }
+
+    /**
+     * Whether a timed-out call had to be interrupted mid-instruction,
+     * leaving this reactor unusable.
+     */
+    public boolean isInterrupted() {
+        return interrupted;
+    }
+
+    private void ensureUsable() {
+        if (interrupted) {
+            throw new IllegalStateException("jq reactor was interrupted by a timeout and must be closed");
+        }
+    }
+
+    private Deadline arm() {
+        return timeout == null ? null : new Deadline(timeout.toNanos());
+    }
+
+    private static void disarm(Deadline deadline) {
+        if (deadline != null) {
+            deadline.stop();
+        }
+    }
+
+    /* what a guest call that threw should rethrow, given its deadline */
+    private RuntimeException abandoned(Deadline deadline, RuntimeException e) {
+        if (deadline == null || !deadline.stop()) {
+            return e;
+        }
+        interrupted = true;
+        return new JqTimeoutException(timeout, true, e);
+    }
+
+    private static final class Watchdog {
+        static final ScheduledThreadPoolExecutor TIMER = newTimer();
+
+        private static ScheduledThreadPoolExecutor newTimer() {
+            var timer = new ScheduledThreadPoolExecutor(1, runnable -> {
+                var thread = new Thread(runnable, "jq4j-watchdog");
+                thread.setDaemon(true);
+                return thread;
+            });
+            timer.setRemoveOnCancelPolicy(true);
+            return timer;
+        }
+    }
+
+    /**
+     * One call's deadline: raises the guest's interrupt flag when it
+     * expires and interrupts the calling thread after the grace period,
+     * unless {@link #stop()} got there first.
+     */
+    private final class Deadline {
+        private final Thread caller = Thread.currentThread();
+        private final int flag = exports.getInterruptFlag();
+        private final ScheduledFuture<?> expiry;
+        private final ScheduledFuture<?> interruption;
+        private boolean stopped;
+        private boolean callerInterrupted;
+
+        Deadline(long nanos) {
+            exports.memory().writeI32(flag, 0);
+            this.expiry = Watchdog.TIMER.schedule(this::expire, nanos, TimeUnit.NANOSECONDS);
+            this.interruption = Watchdog.TIMER.schedule(
+                    this::interrupt, nanos + INTERRUPT_GRACE_NANOS, TimeUnit.NANOSECONDS);
+        }
+
+        private synchronized void expire() {
+            if (!stopped) {
+                exports.memory().writeI32(flag, 1);
+            }
+        }
+
+        private synchronized void interrupt() {
+            if (!stopped) {
+                callerInterrupted = true;
+                caller.interrupt();
+            }
+        }
+
+        /* idempotent; true if the caller's thread was interrupted */
+        boolean stop() {
+            synchronized (this) {
+                if (!stopped) {
+                    stopped = true;
+                    expiry.cancel(false);
+                    interruption.cancel(false);
+                    exports.memory().writeI32(flag, 0);
+                }
+            }
+            if (callerInterrupted) {
+                Thread.interrupted();
+            }
+            return callerInterrupted;
+        }
+    }
+
+    /**
+     * Turns per-phase timing inside the guest on or off.  Counters for
+     * bytes and results are always kept; the phase times stay zero while
+     * disabled because every measurement is a WASI clock call.
+     */
+    public void setStatsEnabled(boolean enabled) {
+        exports.setStatsEnabled(enabled ? 1 : 0);
+    }
+
+    /**
+     * Hands the {@link CallStats} of every completed call to
+     * {@code listener}, e.g. to feed a metrics registry, and enables
+     * timing.  {@code null} removes the listener and disables timing.
+     * Every call is also recorded as an {@code io.roastedroot.jq4j.Call}
+     * JFR event when that event is enabled in a recording.
+     */
+    public void setStatsListener(Consumer<CallStats> listener) {
+        this.statsListener = listener;
+        setStatsEnabled(listener != null);
+    }
+
+    /**
+     * Phase timing and counters of the most recent call.
+     */
+    public CallStats lastCallStats() {
+        var stats = ByteBuffer.wrap(exports.memory().readBytes(exports.getCallStats(), CALL_STATS_SIZE))
+                .order(ByteOrder.LITTLE_ENDIAN);
+        return new CallStats(
+                1,
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                copyInNanos,
+                copyOutNanos,
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong());
+    }
+
+    /**
+     * Resizes the per-reactor cache of compiled programs used by
+     * {@link #process(byte[], byte[], int)}.  Resizing drops every
+     * cached program; {@code 0} disables the cache entirely.
+     */
+    public void setFilterCacheSize(int size) {
+        if (size < 0) {
+            throw new IllegalArgumentException("size must not be negative, got: " + size);
+        }
+        if (exports.setFilterCacheSize(size) != 0) {
+            throw new RuntimeException("jq filter cache resize failed: " + size);
+        }
+    }
+
+    /**
+     * Caps how much staging and output buffer space the guest keeps
+     * between calls.  A buffer that grew past {@code bytes} for one large
+     * call is released before the next one; {@code 0} keeps everything.
+     *
+     * <p>WASM linear memory itself never shrinks, so this only returns
+     * space to the guest's heap.  Use
+     * {@link JqReactorPool.Builder#withMaxMemoryPages(int)} to recycle
+     * reactors whose memory has grown too large.
+     */
+    public void setBufferRetention(int bytes) {
+        if (bytes < 0) {
+            throw new IllegalArgumentException("bytes must not be negative, got: " + bytes);
+        }
+        exports.setBufferRetention(bytes);
+    }
+
+    /**
+     * Binds named arguments, like jq's {@code --arg}/{@code --argjson},
+     * for filters compiled from now on: every member of the JSON object
+     * {@code namedArgs} becomes {@code $name}, and the object is also
+     * {@code $ARGS.named}.  {@code null} removes them.  Cached programs
+     * and {@link CompiledFilter} handles keep the bindings they were
+     * compiled with.
+     *
+     * @throws IllegalArgumentException if {@code namedArgs} is not a JSON
+     *                                  object
+     */
+    public void setNamedArgs(String namedArgs) {
+        if (Objects.equals(namedArgs, this.namedArgs)) {
+            return;
+        }
+        int rc;
+        if (namedArgs == null) {
+            rc = exports.setArgs(0, 0);
+        } else {
+            byte[] json = namedArgs.getBytes(StandardCharsets.UTF_8);
+            int ptr = staging(json.length);
+            copyIn(ptr, json);
+            rc = exports.setArgs(ptr, json.length);
+        }
+        if (rc != 0) {
+            this.namedArgs = null; // the guest drops the old bindings first
+        }
+        if (rc == RC_ERROR_ARGS) {
+            throw new IllegalArgumentException("named arguments are not a JSON object: " + namedArgs);
+        }
+        if (rc != 0) {
+            throw new RuntimeException("jq named arguments failed: " + rc);
+        }
+        this.namedArgs = namedArgs;
+    }
+
+    /**
+     * Current size of this reactor's linear memory, in 64KiB WASM pages.
+     */
+    public int memoryPages() {
+        return exports.memory().pages();
+    }
+
+    /**
+     * Snapshot of the compiled-program cache counters.
+     */
+    public FilterCacheStats filterCacheStats() {
+        int ptr = exports.getFilterCacheStats();
+        var memory = exports.memory();
+        return new FilterCacheStats(
+                memory.readInt(ptr), memory.readInt(ptr + 4), memory.readInt(ptr + 8));
+    }
+
+    /**
+     * Linear memory and guest heap usage right now, e.g. to recycle
+     * reactors or alert well before the 4GiB memory limit.
+     */
+    public HeapStats heapStats() {
+        ensureUsable();
+        var stats = ByteBuffer.wrap(exports.memory().readBytes(exports.getHeapStats(), HEAP_STATS_SIZE))
+                .order(ByteOrder.LITTLE_ENDIAN);
+        return new HeapStats(
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong(),
+                stats.getLong());
+    }
+
+    private static String describe(byte[] filter) {
+        return new String(filter, StandardCharsets.UTF_8);
+    }
+
     public byte[] stdout() {
         return stdout.toByteArray();
     }
 
+    /**
+     * What the guest wrote to WASI stderr during the last call.  jq's
+     * {@code debug} and {@code stderr} messages are dropped, and errors
+     * are reported through {@link JqException}, so this is normally
+     * empty.
+     */
     public byte[] stderr() {
         return stderr.toByteArray();
     }
@@ -128,7 +1162,297 @@ public final class JqReactor implements AutoCloseable {
     }
 
     public static Builder build() {
-        return new Builder(new JqReactor());
+        return build(ByteArrayMemory::new);
+    }
+
+    /**
+     * Like {@link #build()}, with the guest's linear memory created by
+     * {@code memoryFactory} instead of the default heap
+     * {@link ByteArrayMemory}, e.g. to keep large memories off the JVM
+     * heap.  {@linkplain #fork() Forks} use the same factory.
+     */
+    public static Builder build(Function<MemoryLimits, Memory> memoryFactory) {
+        return new Builder(new JqReactor(Objects.requireNonNull(memoryFactory), true));
+    }
+
+    /**
+     * A reactor recreated from a {@link #snapshot()}, without running
+     * jq's initialisation or recompiling the filters it had cached.
+     *
+     * @throws IllegalArgumentException if {@code snapshot} is not one,
+     *                                  or was taken with another jq.wasm
+     */
+    public static Builder restore(byte[] snapshot) {
+        return restore(snapshot, ByteArrayMemory::new);
+    }
+
+    public static Builder restore(byte[] snapshot, Function<MemoryLimits, Memory> memoryFactory) {
+        var reactor = new JqReactor(Objects.requireNonNull(memoryFactory), false);
+        reactor.restoreGuestState(snapshot);
+        return new Builder(reactor);
+    }
+
+    /**
+     * Where the time of one call (or, summed by {@link JqReactorPool},
+     * of many calls) went.  Compile, parse, execute and dump are measured
+     * inside the guest and are only non-zero while stats are enabled;
+     * copy-in/copy-out is the Java side of the linear memory boundary.
+     */
+    public static final class CallStats {
+        private final long calls;
+        private final long compileNanos;
+        private final long parseNanos;
+        private final long executeNanos;
+        private final long dumpNanos;
+        private final long copyInNanos;
+        private final long copyOutNanos;
+        private final long bytesIn;
+        private final long bytesOut;
+        private final long results;
+
+        CallStats(
+                long calls,
+                long compileNanos,
+                long parseNanos,
+                long executeNanos,
+                long dumpNanos,
+                long copyInNanos,
+                long copyOutNanos,
+                long bytesIn,
+                long bytesOut,
+                long results) {
+            this.calls = calls;
+            this.compileNanos = compileNanos;
+            this.parseNanos = parseNanos;
+            this.executeNanos = executeNanos;
+            this.dumpNanos = dumpNanos;
+            this.copyInNanos = copyInNanos;
+            this.copyOutNanos = copyOutNanos;
+            this.bytesIn = bytesIn;
+            this.bytesOut = bytesOut;
+            this.results = results;
+        }
+
+        public long calls() {
+            return calls;
+        }
+
+        public long compileNanos() {
+            return compileNanos;
+        }
+
+        public long parseNanos() {
+            return parseNanos;
+        }
+
+        public long executeNanos() {
+            return executeNanos;
+        }
+
+        public long dumpNanos() {
+            return dumpNanos;
+        }
+
+        public long copyInNanos() {
+            return copyInNanos;
+        }
+
+        public long copyOutNanos() {
+            return copyOutNanos;
+        }
+
+        public long bytesIn() {
+            return bytesIn;
+        }
+
+        public long bytesOut() {
+            return bytesOut;
+        }
+
+        public long results() {
+            return results;
+        }
+
+        @Override
+        public String toString() {
+            return "CallStats{calls=" + calls
+                    + ", compileNanos=" + compileNanos
+                    + ", parseNanos=" + parseNanos
+                    + ", executeNanos=" + executeNanos
+                    + ", dumpNanos=" + dumpNanos
+                    + ", copyInNanos=" + copyInNanos
+                    + ", copyOutNanos=" + copyOutNanos
+                    + ", bytesIn=" + bytesIn
+                    + ", bytesOut=" + bytesOut
+                    + ", results=" + results + "}";
+        }
+    }
+
+    /**
+     * Hit/miss/eviction counters of a reactor's compiled-program cache.
+     */
+    public static final class FilterCacheStats {
+        private final long hits;
+        private final long misses;
+        private final long evictions;
+
+        FilterCacheStats(long hits, long misses, long evictions) {
+            this.hits = hits;
+            this.misses = misses;
+            this.evictions = evictions;
+        }
+
+        public long hits() {
+            return hits;
+        }
+
+        public long misses() {
+            return misses;
+        }
+
+        public long evictions() {
+            return evictions;
+        }
+
+        @Override
+        public String toString() {
+            return "FilterCacheStats{hits=" + hits
+                    + ", misses=" + misses
+                    + ", evictions=" + evictions + "}";
+        }
+    }
+
+    /**
+     * Snapshot of a reactor's memory footprint, see {@link #heapStats()}.
+     * Heap figures count what jq, oniguruma and the wrapper allocated
+     * through malloc, by usable size; {@link #freeBytes()} is what the
+     * allocator holds beyond that, including its own overhead.
+     */
+    public static final class HeapStats {
+        private final long memoryBytes;
+        private final long memoryLimitBytes;
+        private final long heapBytes;
+        private final long inUseBytes;
+        private final long peakInUseBytes;
+        private final long outputBufferBytes;
+        private final long inputBufferBytes;
+
+        HeapStats(
+                long memoryBytes,
+                long memoryLimitBytes,
+                long heapBytes,
+                long inUseBytes,
+                long peakInUseBytes,
+                long outputBufferBytes,
+                long inputBufferBytes) {
+            this.memoryBytes = memoryBytes;
+            this.memoryLimitBytes = memoryLimitBytes;
+            this.heapBytes = heapBytes;
+            this.inUseBytes = inUseBytes;
+            this.peakInUseBytes = peakInUseBytes;
+            this.outputBufferBytes = outputBufferBytes;
+            this.inputBufferBytes = inputBufferBytes;
+        }
+
+        /** Current size of linear memory; it never shrinks. */
+        public long memoryBytes() {
+            return memoryBytes;
+        }
+
+        /** Size linear memory may grow to before allocations fail. */
+        public long memoryLimitBytes() {
+            return memoryLimitBytes;
+        }
+
+        /** Heap the allocator has taken from linear memory so far. */
+        public long heapBytes() {
+            return heapBytes;
+        }
+
+        /** Live allocations. */
+        public long inUseBytes() {
+            return inUseBytes;
+        }
+
+        /** Heap held by the allocator but not in use. */
+        public long freeBytes() {
+            return Math.max(0, heapBytes - inUseBytes);
+        }
+
+        /** Most live allocations at any one time since instantiation. */
+        public long peakInUseBytes() {
+            return peakInUseBytes;
+        }
+
+        /** Capacity of the guest output buffer, part of {@link #inUseBytes()}. */
+        public long outputBufferBytes() {
+            return outputBufferBytes;
+        }
+
+        /** Capacity of the guest staging buffer, part of {@link #inUseBytes()}. */
+        public long inputBufferBytes() {
+            return inputBufferBytes;
+        }
+
+        @Override
+        public String toString() {
+            return "HeapStats{memoryBytes=" + memoryBytes
+                    + ", memoryLimitBytes=" + memoryLimitBytes
+                    + ", heapBytes=" + heapBytes
+                    + ", inUseBytes=" + inUseBytes
+                    + ", peakInUseBytes=" + peakInUseBytes
+                    + ", outputBufferBytes=" + outputBufferBytes
+                    + ", inputBufferBytes=" + inputBufferBytes + "}";
+        }
+    }
+
+    /**
+     * A jq program compiled inside a specific {@link JqReactor}.
+     *
+     * <p>Handles are only valid on the reactor that created them and
+     * become unusable once {@linkplain #close() closed}.
+     */
+    public static final class CompiledFilter implements AutoCloseable {
+        private final JqReactor reactor;
+        private final byte[] source;
+        private int handle;
+
+        private CompiledFilter(JqReactor reactor, int handle, byte[] source) {
+            this.reactor = reactor;
+            this.handle = handle;
+            this.source = source;
+        }
+
+        /** The filter source this handle was compiled from. */
+        public String filter() {
+            return describe(source);
+        }
+
+        byte[] source() {
+            return source;
+        }
+
+        int handleFor(JqReactor caller) {
+            if (caller != reactor) {
+                throw new IllegalArgumentException(
+                        "CompiledFilter belongs to a different reactor");
+            }
+            if (handle == 0) {
+                throw new IllegalStateException("CompiledFilter already closed");
+            }
+            return handle;
+        }
+
+        /**
+         * Releases the compiled program inside the guest.
+         */
+        @Override
+        public void close() {
+            if (handle != 0) {
+                reactor.exports.freeCompiled(handle);
+                handle = 0;
+            }
+        }
     }
 
     public static final class Builder implements AutoCloseable {
@@ -136,7 +1460,10 @@ public final class JqReactor implements AutoCloseable {
 
         private byte[] input;
         private byte[] filter;
+        private CompiledFilter compiled;
         private int flags;
+        private final Map<String, String> args = new LinkedHashMap<>();
+        private Duration timeout;
 
         private Builder(JqReactor reactor) {
             this.reactor = reactor;
@@ -146,6 +1473,15 @@ public final class JqReactor implements AutoCloseable {
             return reactor;
         }
 
+        /**
+         * A builder over a {@linkplain JqReactor#fork() fork} of this
+         * builder's reactor; use {@code template::fork} as a
+         * {@link JqReactorPool} reactor factory.
+         */
+        public Builder fork() {
+            return new Builder(reactor.fork());
+        }
+
         public Builder withInput(String input) {
             return withInput(input.getBytes(StandardCharsets.UTF_8));
         }
@@ -161,6 +1497,13 @@ public final class JqReactor implements AutoCloseable {
 
         public Builder withFilter(byte[] filter) {
             this.filter = filter;
+            this.compiled = null;
+            return this;
+        }
+
+        public Builder withFilter(CompiledFilter filter) {
+            this.compiled = filter;
+            this.filter = null;
             return this;
         }
 
@@ -184,11 +1527,123 @@ public final class JqReactor implements AutoCloseable {
             return this;
         }
 
+        /**
+         * Writes results as CBOR instead of JSON text.
+         *
+         * @see JqCbor#decode(byte[])
+         */
+        public Builder withCborOutput() {
+            this.flags |= FLAG_CBOR;
+            return this;
+        }
+
+        /**
+         * Parses only the fields a field-path filter reads.  Has no
+         * effect together with stream, seq or raw input.
+         *
+         * @see JqReactor#FLAG_PROJECT
+         */
+        public Builder withPathProjection() {
+            this.flags |= FLAG_PROJECT;
+            return this;
+        }
+
+        public Builder withStreamInput() {
+            this.flags |= FLAG_STREAM;
+            return this;
+        }
+
+        public Builder withSeq() {
+            this.flags |= FLAG_SEQ;
+            return this;
+        }
+
+        public Builder withRawInput() {
+            this.flags |= FLAG_RAW_INPUT;
+            return this;
+        }
+
+        public Builder withRawOutput() {
+            this.flags |= FLAG_RAW_OUTPUT;
+            return this;
+        }
+
+        public Builder withJoinOutput() {
+            this.flags |= FLAG_JOIN_OUTPUT;
+            return this;
+        }
+
+        /** Binds {@code $name} to the string {@code value}, like {@code --arg}. */
+        public Builder withArg(String name, String value) {
+            args.put(name, quote(value));
+            return this;
+        }
+
+        /** Binds {@code $name} to the JSON text {@code json}, like {@code --argjson}. */
+        public Builder withArgJson(String name, String json) {
+            args.put(name, json);
+            return this;
+        }
+
+        /**
+         * Bounds this run to {@code timeout}; a filter still running
+         * then throws {@link JqTimeoutException}.
+         *
+         * @see JqReactor#setTimeout(Duration)
+         */
+        public Builder withTimeout(Duration timeout) {
+            if (timeout.isNegative() || timeout.isZero()) {
+                throw new IllegalArgumentException("timeout must be positive: " + timeout);
+            }
+            this.timeout = timeout;
+            return this;
+        }
+
+        /**
+         * Sets how many compiled programs the reactor keeps for reuse
+         * across {@link #run()} calls (default 16).  This is a reactor
+         * setting and survives {@link JqReactorPool} returns.
+         */
+        public Builder withFilterCacheSize(int size) {
+            reactor.setFilterCacheSize(size);
+            return this;
+        }
+
+        /**
+         * Releases guest buffers larger than {@code bytes} between calls.
+         * This is a reactor setting and survives {@link JqReactorPool}
+         * returns.
+         *
+         * @see JqReactor#setBufferRetention(int)
+         */
+        public Builder withBufferRetention(int bytes) {
+            reactor.setBufferRetention(bytes);
+            return this;
+        }
+
+        /**
+         * Reports per-call stats to {@code listener}.  This is a reactor
+         * setting and survives {@link JqReactorPool} returns.
+         *
+         * @see JqReactor#setStatsListener(Consumer)
+         */
+        public Builder withStatsListener(Consumer<CallStats> listener) {
+            reactor.setStatsListener(listener);
+            return this;
+        }
+
         public byte[] run() {
             Objects.requireNonNull(input);
-            Objects.requireNonNull(filter);
+            applyArgs();
+            reactor.setTimeout(timeout);
 
-            var result = reactor.process(input, filter, flags);
+            byte[] result;
+            if (compiled != null) {
+                result = reactor.process(input, compiled, flags);
+            } else {
+                Objects.requireNonNull(filter);
+                result = reactor.process(input, filter, flags);
+            }
 
             // clean up for next execution
             reset();
@@ -196,11 +1651,90 @@ public final class JqReactor implements AutoCloseable {
             return result;
         }
 
+        /**
+         * Like {@link #run()}, but streams the output into {@code out}
+         * instead of returning it as one array.
+         */
+        public void run(OutputStream out) {
+            Objects.requireNonNull(input);
+            Objects.requireNonNull(out);
+            applyArgs();
+            reactor.setTimeout(timeout);
+
+            if (compiled != null) {
+                reactor.process(input, compiled, flags, out);
+            } else {
+                Objects.requireNonNull(filter);
+                reactor.process(input, filter, flags, out);
+            }
+
+            // clean up for next execution
+            reset();
+        }
+
+        /**
+         * Like {@link #run()}, but hands every result to {@code consumer}
+         * as it is produced.
+         *
+         * @see JqReactor#stream(byte[], byte[], int, Consumer)
+         */
+        public void stream(Consumer<byte[]> consumer) {
+            Objects.requireNonNull(input);
+
+            try {
+                applyArgs();
+                reactor.setTimeout(timeout);
+                if (compiled != null) {
+                    reactor.stream(input, compiled, flags, consumer);
+                } else {
+                    Objects.requireNonNull(filter);
+                    reactor.stream(input, filter, flags, consumer);
+                }
+            } finally {
+                // clean up for next execution
+                reset();
+            }
+        }
+
+        /* binds this run's --arg/--argjson values, or clears the last ones */
+        private void applyArgs() {
+            if (args.isEmpty()) {
+                reactor.setNamedArgs(null);
+                return;
+            }
+            var json = new StringBuilder("{");
+            for (var arg : args.entrySet()) {
+                if (json.length() > 1) {
+                    json.append(',');
+                }
+                json.append(quote(arg.getKey())).append(':').append(arg.getValue());
+            }
+            reactor.setNamedArgs(json.append('}').toString());
+        }
+
+        private static String quote(String s) {
+            var json = new StringBuilder(s.length() + 2).append('"');
+            for (int i = 0; i < s.length(); i++) {
+                char c = s.charAt(i);
+                if (c == '"' || c == '\\') {
+                    json.append('\\').append(c);
+                } else if (c < 0x20) {
+                    json.append(String.format("\\u%04x", (int) c));
+                } else {
+                    json.append(c);
+                }
+            }
+            return json.append('"').toString();
+        }
+
         /** Package-private: used by {@link JqReactorPool} on return. */
         void reset() {
             input = null;
             filter = null;
+            compiled = null;
             flags = 0;
+            args.clear();
+            timeout = null;
         }
 
         @Override
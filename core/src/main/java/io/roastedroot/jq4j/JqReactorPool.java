@@ -1,8 +1,37 @@
 package io.roastedroot.jq4j;
 
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.io.UncheckedIOException;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.time.Duration;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Objects;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.CompletionException;
+import java.util.concurrent.ConcurrentHashMap;
 import java.util.concurrent.ConcurrentLinkedDeque;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.Executor;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RejectedExecutionException;
+import java.util.concurrent.ScheduledExecutorService;
 import java.util.concurrent.Semaphore;
+import java.util.concurrent.TimeUnit;
 import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicReferenceArray;
+import java.util.concurrent.atomic.LongAdder;
+import java.util.function.Supplier;
 
 /**
  * Thread-safe pool of {@link JqReactor} instances.
@@ -29,16 +58,108 @@ import java.util.concurrent.atomic.AtomicBoolean;
  *
  * pool.close();
  * }</pre>
+ *
+ * <p>Use {@link #builder()} to customise how reactors are created and
+ * when they are recycled.
+ *
+ * <p>With {@link Builder#withThreadAffinity()}, a returned reactor is
+ * parked in a slot picked by the returning thread and keeps its permit,
+ * so the next borrow from that thread takes it back without touching
+ * the shared semaphore or deque, and finds its filter cache warm.
+ * Callers that miss their slot steal from other slots before blocking.
  */
 public final class JqReactorPool implements AutoCloseable {
 
-    private final ConcurrentLinkedDeque<JqReactor.Builder> idle;
+    private final ConcurrentLinkedDeque<IdleReactor> idle;
     private final Semaphore permits;
     private final AtomicBoolean closed = new AtomicBoolean();
+    private final Supplier<JqReactor.Builder> factory;
+    private final int maxSize;
+    private final int maxMemoryPages;
+    private final int minIdle;
+    private final long idleTimeoutNanos;
+    private final boolean collectStats;
+    private final boolean collectMemoryStats;
+    private final Duration callTimeout;
+    private final StatsTotals totals = new StatsTotals();
+
+    /* ── reactors alive, idle or borrowed; bounds background creation ── */
+    private final AtomicInteger live = new AtomicInteger();
+
+    /* ── thread-affine slots, null without withThreadAffinity() ─────── *
+     * Only every SLOT_STRIDE-th element is used so that neighbouring  *
+     * slots do not share a cache line.                                */
+    private static final int SLOT_STRIDE = 16;
+    private static final long STEAL_PARK_NANOS = TimeUnit.MILLISECONDS.toNanos(1);
+    private static final IdleReactor TIMED_OUT = new IdleReactor(null, 0);
+
+    /* ── processParallel() cuts its input into chunks of about this size ── */
+    private static final int PARALLEL_CHUNK_SIZE = 1024 * 1024;
+    private final AtomicReferenceArray<IdleReactor> slots;
+    private final int slotMask;
+
+    /* ── refill/eviction thread, null without minIdle or idle timeout ── */
+    private final ScheduledExecutorService maintenance;
+    private final AtomicBoolean refillPending = new AtomicBoolean();
 
-    private JqReactorPool(int maxSize) {
+    /* ── submit() requests waiting for a reactor ───────────────────── */
+    private final ConcurrentLinkedQueue<Waiter> waiters = new ConcurrentLinkedQueue<>();
+    private final AtomicInteger queued = new AtomicInteger();
+    private final int maxQueueDepth;
+    private final Executor executor;
+
+    /* ── outputs of earlier submit()/process() requests, or null ────── */
+    private final JqResultCache resultCache;
+
+    /* ── memory pages of every live reactor as of its last return ──── */
+    private final ConcurrentHashMap<JqReactor.Builder, Integer> footprints = new ConcurrentHashMap<>();
+    private final LongAdder totalPages = new LongAdder();
+    private final AtomicInteger maxReactorPages = new AtomicInteger();
+    private final AtomicLong peakHeapInUse = new AtomicLong();
+
+    private JqReactorPool(Builder builder) {
         this.idle = new ConcurrentLinkedDeque<>();
-        this.permits = new Semaphore(maxSize);
+        this.permits = new Semaphore(builder.maxSize);
+        this.factory = builder.factory;
+        this.maxSize = builder.maxSize;
+        this.maxMemoryPages = builder.maxMemoryPages;
+        this.minIdle = builder.minIdle;
+        this.idleTimeoutNanos = builder.idleTimeout == null ? 0 : builder.idleTimeout.toNanos();
+        this.collectStats = builder.collectStats;
+        this.collectMemoryStats = builder.collectMemoryStats;
+        this.callTimeout = builder.callTimeout;
+        this.maxQueueDepth = builder.maxQueueDepth;
+        this.executor = builder.executor;
+        this.resultCache = builder.resultCacheBytes > 0
+                ? new JqResultCache(builder.resultCacheBytes)
+                : null;
+
+        if (builder.threadAffinity) {
+            int wanted = Math.max(maxSize, Runtime.getRuntime().availableProcessors()) * 2;
+            int count = Integer.highestOneBit(wanted - 1) << 1;
+            this.slots = new AtomicReferenceArray<>(count * SLOT_STRIDE);
+            this.slotMask = count - 1;
+        } else {
+            this.slots = null;
+            this.slotMask = 0;
+        }
+
+        if (minIdle > 0 || idleTimeoutNanos > 0) {
+            this.maintenance = Executors.newSingleThreadScheduledExecutor(runnable -> {
+                var thread = new Thread(runnable, "jq4j-pool-maintenance");
+                thread.setDaemon(true);
+                return thread;
+            });
+        } else {
+            this.maintenance = null;
+        }
+        if (idleTimeoutNanos > 0) {
+            // check twice per timeout so a reactor idles at most 1.5x as long
+            long period = Math.max(idleTimeoutNanos / 2, TimeUnit.MILLISECONDS.toNanos(10));
+            maintenance.scheduleAtFixedRate(
+                    this::evictExpired, period, period, TimeUnit.NANOSECONDS);
+        }
+        scheduleRefill();
     }
 
     /**
@@ -46,10 +167,11 @@ public final class JqReactorPool implements AutoCloseable {
      * reactor instances.
      */
     public static JqReactorPool create(int maxSize) {
-        if (maxSize <= 0) {
-            throw new IllegalArgumentException("maxSize must be positive, got: " + maxSize);
-        }
-        return new JqReactorPool(maxSize);
+        return builder().withMaxSize(maxSize).build();
+    }
+
+    public static Builder builder() {
+        return new Builder();
     }
 
     /**
@@ -63,15 +185,358 @@ public final class JqReactorPool implements AutoCloseable {
      * @throws IllegalStateException if the pool has been closed
      */
     public Loan borrow() throws InterruptedException {
+        return acquire(-1);
+    }
+
+    /**
+     * Borrows a reactor, waiting at most {@code timeout} for one to
+     * become available.  {@link Duration#ZERO} never blocks.
+     *
+     * @return the loan, or {@code null} if the timeout elapsed first
+     * @throws InterruptedException if the calling thread is interrupted
+     *         while waiting
+     * @throws IllegalStateException if the pool has been closed
+     */
+    public Loan tryBorrow(Duration timeout) throws InterruptedException {
+        return acquire(Math.max(0, timeout.toNanos()));
+    }
+
+    /**
+     * Runs a jq filter on a pooled reactor without blocking the caller.
+     * If no reactor is free, the request waits in a bounded queue and is
+     * handed the next reactor that comes back; the filter itself runs on
+     * the pool's {@linkplain Builder#withExecutor executor}, and so does
+     * creating a reactor when none is idle.
+     *
+     * <p>The future fails with {@link RejectedExecutionException} when
+     * the queue is full, with {@link IllegalStateException} if the pool
+     * closes first, and with the jq error otherwise.
+     */
+    public CompletableFuture<byte[]> submit(byte[] input, byte[] filter, int flags) {
+        return enqueue(new Waiter(input, filter, flags, resultCache != null));
+    }
+
+    private CompletableFuture<byte[]> enqueue(Waiter request) {
+        if (closed.get()) {
+            request.future.completeExceptionally(new IllegalStateException("Pool is closed"));
+            return request.future;
+        }
+        if (request.cacheable) {
+            byte[] cached = resultCache.get(request.input, request.filter, request.flags);
+            if (cached != null) {
+                request.future.complete(cached);
+                return request.future;
+            }
+        }
+        if (waiters.isEmpty()) {
+            Loan loan = pollLoan();
+            if (loan != null) {
+                run(request, loan);
+                return request.future;
+            }
+        }
+        if (queued.incrementAndGet() > maxQueueDepth) {
+            queued.decrementAndGet();
+            request.future.completeExceptionally(new RejectedExecutionException(
+                    "jq pool queue is full: " + maxQueueDepth + " waiting requests"));
+            return request.future;
+        }
+        waiters.offer(request);
+        drainWaiters();
+        return request.future;
+    }
+
+    /**
+     * Runs a jq filter on a pooled reactor, blocking until one is free.
+     * With {@link Builder#withResultCache(long)}, a request identical to
+     * an earlier successful one is answered from the cache without
+     * borrowing a reactor.
+     *
+     * @throws JqException if the filter fails
+     * @throws InterruptedException if interrupted while waiting
+     */
+    public byte[] process(byte[] input, byte[] filter, int flags) throws InterruptedException {
+        if (resultCache != null) {
+            byte[] cached = resultCache.get(input, filter, flags);
+            if (cached != null) {
+                return cached;
+            }
+        }
+        byte[] result = processBorrowed(input, filter, flags);
+        if (resultCache != null) {
+            resultCache.put(input, filter, flags, result);
+        }
+        return result;
+    }
+
+    /* process() on the calling thread, without the result cache */
+    private byte[] processBorrowed(byte[] input, byte[] filter, int flags)
+            throws InterruptedException {
+        byte[] result;
+        Loan loan = borrow();
+        try {
+            result = execute(loan, input, filter, flags);
+        } catch (JqException | JqTimeoutException e) {
+            // release() still replaces a reactor the timeout had to interrupt
+            loan.close();
+            throw e;
+        } catch (RuntimeException e) {
+            // anything else may have left the reactor broken
+            loan.discard();
+            throw e;
+        }
+        loan.close();
+        return result;
+    }
+
+    /**
+     * Hit and size counters of the {@linkplain Builder#withResultCache
+     * result cache}; all zero when it is disabled.
+     */
+    public ResultCacheStats resultCacheStats() {
+        return resultCache == null ? new ResultCacheStats(0, 0, 0, 0, 0) : resultCache.stats();
+    }
+
+    /**
+     * Number of {@link #submit} requests waiting for a reactor.
+     */
+    public int queuedCount() {
+        return queued.get();
+    }
+
+    /**
+     * Runs a jq filter over a stream of independent JSON values (e.g.
+     * NDJSON) on several pooled reactors at once.  The input is cut at
+     * top-level value boundaries into chunks of about 1MiB, each chunk is
+     * {@linkplain #submit submitted}, and the outputs are written to
+     * {@code out} in input order.  The calling thread scans and writes
+     * while the pool's executor runs jq; when other requests have filled
+     * the {@linkplain Builder#withMaxQueueDepth queue}, it runs the
+     * chunk itself.
+     *
+     * <p>Only filters that treat every input on its own give the same
+     * result as a sequential run: {@link JqReactor#FLAG_SLURP} and
+     * {@link JqReactor#FLAG_NULL_INPUT} are rejected, as are
+     * {@link JqReactor#FLAG_RAW_INPUT} and {@link JqReactor#FLAG_SEQ},
+     * whose input is not cut at JSON boundaries, and
+     * {@code input}/{@code inputs} only see their own chunk.
+     *
+     * @throws JqException after all output has been written, if any
+     *                     input failed; indices are positions in the
+     *                     whole stream
+     */
+    public void processParallel(InputStream input, byte[] filter, int flags, OutputStream out) {
+        if ((flags & (JqReactor.FLAG_SLURP | JqReactor.FLAG_NULL_INPUT)) != 0) {
+            throw new IllegalArgumentException(
+                    "FLAG_SLURP and FLAG_NULL_INPUT need the whole input in one reactor");
+        }
+        if ((flags & (JqReactor.FLAG_RAW_INPUT | JqReactor.FLAG_SEQ)) != 0) {
+            throw new IllegalArgumentException(
+                    "FLAG_RAW_INPUT and FLAG_SEQ input cannot be split at JSON value boundaries");
+        }
+        new ParallelRun(filter, flags, out).run(input);
+    }
+
+    /** {@link #processParallel(InputStream, byte[], int, OutputStream)} over a file. */
+    public void processParallel(Path input, byte[] filter, int flags, OutputStream out) {
+        try (var in = Files.newInputStream(input)) {
+            processParallel(in, filter, flags, out);
+        } catch (IOException e) {
+            throw new UncheckedIOException(e);
+        }
+    }
+
+    /**
+     * {@link #processParallel(InputStream, byte[], int, OutputStream)} over
+     * an in-memory input, returning the concatenated output.
+     */
+    public byte[] processParallel(byte[] input, byte[] filter, int flags) {
+        var out = new ByteArrayOutputStream();
+        try {
+            processParallel(new ByteArrayInputStream(input), filter, flags, out);
+        } catch (JqException e) {
+            throw new JqException(e.getMessage(), e.errors(), e.droppedErrors(), out.toByteArray());
+        }
+        return out.toByteArray();
+    }
+
+    /* one processParallel() call: cuts chunks, keeps them in order */
+    private final class ParallelRun {
+        private final byte[] filter;
+        private final int flags;
+        private final OutputStream out;
+        private final JsonStructuralScanner scanner = new JsonStructuralScanner();
+        private final ArrayDeque<Chunk> inflight = new ArrayDeque<>();
+        private final List<JqException.ErrorRecord> errors = new ArrayList<>();
+        private int droppedErrors;
+
+        ParallelRun(byte[] filter, int flags, OutputStream out) {
+            this.filter = filter;
+            this.flags = flags;
+            this.out = out;
+        }
+
+        void run(InputStream input) {
+            // running plus queued; submitChunk copes with a queue others filled
+            int maxInFlight = maxSize + Math.min(maxSize, maxQueueDepth);
+            byte[] buf = new byte[PARALLEL_CHUNK_SIZE * 2];
+            int len = 0;
+            int scanned = 0;
+            long firstValue = 0;
+            try {
+                while (true) {
+                    if (len == buf.length) {
+                        // a single value larger than the buffer
+                        buf = Arrays.copyOf(buf, buf.length * 2);
+                    }
+                    int n = input.read(buf, len, buf.length - len);
+                    boolean eof = n < 0;
+                    if (eof && len == 0) {
+                        break;
+                    }
+                    len += Math.max(n, 0);
+
+                    int cut = -1;
+                    while (scanned < len && cut < 0) {
+                        int boundary = scanner.nextBoundary(buf, scanned, len);
+                        scanned = boundary < 0 ? len : boundary;
+                        if (boundary >= PARALLEL_CHUNK_SIZE) {
+                            cut = boundary;
+                        }
+                    }
+                    if (cut < 0 && eof) {
+                        cut = len;
+                    }
+                    if (cut < 0) {
+                        continue;
+                    }
+
+                    byte[] chunk = Arrays.copyOf(buf, cut);
+                    inflight.add(new Chunk(submitChunk(chunk), firstValue));
+                    firstValue = scanner.values();
+                    System.arraycopy(buf, cut, buf, 0, len - cut);
+                    len -= cut;
+                    scanned -= cut;
+
+                    while (inflight.size() >= maxInFlight) {
+                        writeNext();
+                    }
+                }
+                while (!inflight.isEmpty()) {
+                    writeNext();
+                }
+            } catch (IOException e) {
+                throw new UncheckedIOException(e);
+            }
+            if (!errors.isEmpty() || droppedErrors > 0) {
+                throw JqReactor.failure("jq failed", errors, droppedErrors, new byte[0]);
+            }
+        }
+
+        /*
+         * Concurrent submit() calls can fill the queue at any time, so a
+         * rejected chunk runs on the calling thread instead of failing
+         * the whole call; that also holds the producer back until the
+         * queue drains.
+         */
+        private CompletableFuture<byte[]> submitChunk(byte[] chunk) {
+            var result = enqueue(new Waiter(chunk, filter, flags, false));
+            if (!rejected(result)) {
+                return result;
+            }
+            try {
+                return CompletableFuture.completedFuture(processBorrowed(chunk, filter, flags));
+            } catch (InterruptedException e) {
+                Thread.currentThread().interrupt();
+                return CompletableFuture.failedFuture(e);
+            } catch (RuntimeException e) {
+                return CompletableFuture.failedFuture(e);
+            }
+        }
+
+        private void writeNext() throws IOException {
+            Chunk chunk = inflight.poll();
+            try {
+                out.write(chunk.result.join());
+            } catch (CompletionException e) {
+                Throwable cause = e.getCause();
+                if (!(cause instanceof JqException)) {
+                    throw cause instanceof RuntimeException ? (RuntimeException) cause : e;
+                }
+                var failure = (JqException) cause;
+                if (!failure.errors().isEmpty() && failure.errors().stream()
+                        .allMatch(r -> r.inputIndex() == JqException.ErrorRecord.NO_INPUT)) {
+                    throw failure; // the filter does not compile, every chunk fails alike
+                }
+                out.write(failure.output());
+                for (var error : failure.errors()) {
+                    errors.add(new JqException.ErrorRecord(
+                            (int) (chunk.firstValue + error.inputIndex()), error.message()));
+                }
+                droppedErrors += failure.droppedErrors();
+            }
+        }
+    }
+
+    private static boolean rejected(CompletableFuture<byte[]> future) {
+        if (!future.isCompletedExceptionally()) {
+            return false;
+        }
+        try {
+            future.join();
+            return false;
+        } catch (CompletionException e) {
+            return e.getCause() instanceof RejectedExecutionException;
+        }
+    }
+
+    private static final class Chunk {
+        private final CompletableFuture<byte[]> result;
+        private final long firstValue;
+
+        Chunk(CompletableFuture<byte[]> result, long firstValue) {
+            this.result = result;
+            this.firstValue = firstValue;
+        }
+    }
+
+    private Loan acquire(long timeoutNanos) throws InterruptedException {
         if (closed.get()) {
             throw new IllegalStateException("Pool is closed");
         }
-        permits.acquire();
+        if (slots != null) {
+            // a parked reactor still holds its permit; read before writing
+            // so a miss does not dirty the slot's cache line
+            int slot = ownSlot();
+            IdleReactor parked = slots.get(slot);
+            if (parked != null && !slots.compareAndSet(slot, parked, null)) {
+                parked = null;
+            }
+            if (parked == null) {
+                parked = acquireOrSteal(timeoutNanos);
+            }
+            if (parked == TIMED_OUT) {
+                return null;
+            }
+            if (parked != null) {
+                return new Loan(this, parked.builder);
+            }
+        } else if (timeoutNanos < 0) {
+            permits.acquire();
+        } else if (timeoutNanos == 0 ? !permits.tryAcquire()
+                : !permits.tryAcquire(timeoutNanos, TimeUnit.NANOSECONDS)) {
+            return null;
+        }
         try {
-            JqReactor.Builder builder = idle.pollFirst();
-            if (builder == null) {
-                builder = JqReactor.build();
+            IdleReactor entry = idle.pollFirst();
+            JqReactor.Builder builder;
+            if (entry != null) {
+                builder = entry.builder;
+            } else {
+                live.incrementAndGet();
+                builder = newReactorReserved();
             }
+            scheduleRefill();
             return new Loan(this, builder);
         } catch (Throwable t) {
             permits.release();
@@ -79,25 +544,409 @@ public final class JqReactorPool implements AutoCloseable {
         }
     }
 
+    /* ── thread affinity ───────────────────────────────────────────── */
+
+    private int ownSlot() {
+        long id = Thread.currentThread().getId();
+        return ((int) ((id * 0x9E3779B97F4A7C15L) >>> 32) & slotMask) * SLOT_STRIDE;
+    }
+
+    /**
+     * Waits for a permit, stealing a parked reactor (with its permit)
+     * from another thread's slot whenever none is free.
+     *
+     * @param timeoutNanos how long to wait, negative for no limit
+     * @return a stolen reactor, {@code null} once a permit is held, or
+     *         {@link #TIMED_OUT}
+     */
+    private IdleReactor acquireOrSteal(long timeoutNanos) throws InterruptedException {
+        long deadline = System.nanoTime() + timeoutNanos;
+        while (!permits.tryAcquire()) {
+            IdleReactor stolen = steal();
+            if (stolen != null) {
+                return stolen;
+            }
+            long wait = STEAL_PARK_NANOS;
+            if (timeoutNanos >= 0) {
+                long left = deadline - System.nanoTime();
+                if (left <= 0) {
+                    return TIMED_OUT;
+                }
+                wait = Math.min(wait, left);
+            }
+            if (permits.tryAcquire(wait, TimeUnit.NANOSECONDS)) {
+                break;
+            }
+            if (closed.get()) {
+                throw new IllegalStateException("Pool is closed");
+            }
+        }
+        return null;
+    }
+
+    private IdleReactor steal() {
+        for (int i = 0; i < slots.length(); i += SLOT_STRIDE) {
+            if (slots.get(i) != null) {
+                IdleReactor stolen = slots.getAndSet(i, null);
+                if (stolen != null) {
+                    return stolen;
+                }
+            }
+        }
+        return null;
+    }
+
+    /* parks in the caller's slot unless someone is waiting for a reactor */
+    private boolean park(JqReactor.Builder builder) {
+        if (permits.hasQueuedThreads() || !waiters.isEmpty()) {
+            return false;
+        }
+        return slots.compareAndSet(
+                ownSlot(), null, new IdleReactor(builder, System.nanoTime()));
+    }
+
+    /**
+     * Creates reactors on the calling thread until {@code minIdle} are
+     * idle, so the first requests after start-up do not pay for
+     * instantiation.
+     *
+     * @return the number of reactors created
+     */
+    public int prewarm() {
+        return prewarm(minIdle);
+    }
+
+    /**
+     * Creates reactors on the calling thread until {@code count} are idle,
+     * without exceeding {@code maxSize} live reactors.
+     *
+     * @return the number of reactors created
+     */
+    public int prewarm(int count) {
+        int created = 0;
+        while (!closed.get() && idleCount() < count && reserve()) {
+            addIdle(newReactorReserved());
+            created++;
+        }
+        return created;
+    }
+
+    private JqReactor.Builder newReactor() {
+        JqReactor.Builder builder = factory.get();
+        if (collectStats) {
+            builder.reactor().setStatsListener(totals::add);
+        }
+        recordFootprint(builder);
+        return builder;
+    }
+
+    /* a guest call and a map update per return, so only with withMemoryStats() */
+    private void recordFootprint(JqReactor.Builder builder) {
+        if (!collectMemoryStats) {
+            return;
+        }
+        var reactor = builder.reactor();
+        int pages = reactor.memoryPages();
+        Integer before = footprints.put(builder, pages);
+        totalPages.add(pages - (before == null ? 0 : before));
+        maxReactorPages.accumulateAndGet(pages, Math::max);
+        peakHeapInUse.accumulateAndGet(reactor.heapStats().peakInUseBytes(), Math::max);
+    }
+
+    /* creates a reactor for an already counted slot, giving it back on failure */
+    private JqReactor.Builder newReactorReserved() {
+        try {
+            return newReactor();
+        } catch (Throwable t) {
+            live.decrementAndGet();
+            throw t;
+        }
+    }
+
+    private boolean reserve() {
+        if (live.incrementAndGet() <= maxSize) {
+            return true;
+        }
+        live.decrementAndGet();
+        return false;
+    }
+
+    private void addIdle(JqReactor.Builder builder) {
+        var entry = new IdleReactor(builder, System.nanoTime());
+        idle.offerFirst(entry);
+        if (closed.get() && idle.remove(entry)) {
+            // lost a race with close()
+            destroy(builder);
+        }
+    }
+
+    /**
+     * Per-call stats summed over every reactor this pool created, while
+     * {@link Builder#withStats()} is set; all zero otherwise.
+     */
+    public JqReactor.CallStats stats() {
+        return totals.sum();
+    }
+
+    /**
+     * Memory footprint of the pool's reactors, as of each one's last
+     * return, and the high-water marks of any single reactor since the
+     * pool was built.  Compare {@link MemoryStats#maxReactorPages()}
+     * against {@link Builder#withMaxMemoryPages(int)} to tune recycling.
+     * All zero unless the pool was built {@link Builder#withMemoryStats()}.
+     */
+    public MemoryStats memoryStats() {
+        return new MemoryStats(
+                footprints.size(), totalPages.sum(), maxReactorPages.get(), peakHeapInUse.get());
+    }
+
+    /**
+     * Number of reactors currently idle in the pool.
+     */
+    public int idleCount() {
+        int count = idle.size();
+        if (slots != null) {
+            for (int i = 0; i < slots.length(); i += SLOT_STRIDE) {
+                if (slots.get(i) != null) {
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+
     private void release(JqReactor.Builder builder) {
+        boolean parked = false;
         try {
-            builder.reset();
-            if (!closed.get()) {
-                idle.offerFirst(builder);
+            boolean interrupted;
+            try {
+                builder.reset();
+                // a timeout that abandoned the guest mid-call leaves nothing to reuse
+                interrupted = builder.reactor().isInterrupted();
+                if (!interrupted) {
+                    // the next borrower must not compile against this one's --arg values
+                    builder.reactor().setNamedArgs(null);
+                    builder.reactor().setTimeout(null);
+                    recordFootprint(builder);
+                }
+            } catch (Throwable t) {
+                // these reach into the guest; one that traps is not reused
+                try {
+                    destroy(builder);
+                } catch (Throwable suppressed) {
+                    t.addSuppressed(suppressed);
+                }
+                scheduleRefill();
+                throw t;
+            }
+            if (interrupted || closed.get() || oversized(builder) || live.get() > maxSize) {
+                destroy(builder);
+                scheduleRefill();
+            } else if (slots != null && park(builder)) {
+                parked = true;
+                if (closed.get()) {
+                    // lost a race with close(), which may have drained slots already
+                    parked = !unpark(builder);
+                }
             } else {
-                builder.close();
+                addIdle(builder);
             }
         } finally {
-            permits.release();
+            if (!parked) {
+                permits.release();
+            }
+            drainWaiters();
+        }
+    }
+
+    /* removes builder from its slot and destroys it, if still parked */
+    private boolean unpark(JqReactor.Builder builder) {
+        int slot = ownSlot();
+        IdleReactor entry = slots.get(slot);
+        if (entry != null && entry.builder == builder && slots.compareAndSet(slot, entry, null)) {
+            destroy(builder);
+            return true;
         }
+        return false;
+    }
+
+    /**
+     * Linear memory never shrinks, so a reactor that once handled an
+     * outlier payload is recycled rather than kept at that size.
+     */
+    private boolean oversized(JqReactor.Builder builder) {
+        return maxMemoryPages > 0 && builder.reactor().memoryPages() > maxMemoryPages;
     }
 
     private void discard(JqReactor.Builder builder) {
         try {
-            builder.close();
+            destroy(builder);
         } finally {
             permits.release();
         }
+        scheduleRefill();
+        drainWaiters();
+    }
+
+    /* ── submit(): hand free reactors to queued requests ────────────── */
+
+    /**
+     * Called after every submit and every return to the pool, so a
+     * queued request cannot miss a reactor freed concurrently.
+     */
+    private void drainWaiters() {
+        while (!waiters.isEmpty()) {
+            Loan loan = pollLoan();
+            if (loan == null) {
+                return;
+            }
+            Waiter request = waiters.poll();
+            if (request == null) {
+                loan.close();
+                return;
+            }
+            queued.decrementAndGet();
+            run(request, loan);
+        }
+    }
+
+    /*
+     * A reactor for a queued request right now, or null; never blocks and
+     * never instantiates, since submit() may be called from an event loop.
+     * With a permit free but nothing idle, the loan is only reserved and
+     * run() creates the reactor on the executor.
+     */
+    private Loan pollLoan() {
+        if (closed.get()) {
+            return null;
+        }
+        if (slots != null) {
+            int slot = ownSlot();
+            IdleReactor parked = slots.get(slot);
+            if (parked != null && slots.compareAndSet(slot, parked, null)) {
+                return new Loan(this, parked.builder);
+            }
+        }
+        if (!permits.tryAcquire()) {
+            IdleReactor stolen = slots == null ? null : steal();
+            return stolen == null ? null : new Loan(this, stolen.builder);
+        }
+        IdleReactor entry = idle.pollFirst();
+        scheduleRefill();
+        if (entry != null) {
+            return new Loan(this, entry.builder);
+        }
+        live.incrementAndGet();
+        return Loan.reserved(this);
+    }
+
+    /* gives back the permit and live count of a loan that never got a reactor */
+    private void unreserve() {
+        live.decrementAndGet();
+        permits.release();
+        drainWaiters();
+    }
+
+    private void run(Waiter request, Loan loan) {
+        try {
+            executor.execute(() -> {
+                if (loan.builder == null) {
+                    try {
+                        loan.builder = newReactorReserved();
+                        loan.reserved = false;
+                    } catch (Throwable t) {
+                        // newReactorReserved() already gave back the live count
+                        loan.reserved = false;
+                        permits.release();
+                        drainWaiters();
+                        request.future.completeExceptionally(t);
+                        return;
+                    }
+                }
+                try {
+                    byte[] result = execute(loan, request.input, request.filter, request.flags);
+                    loan.close();
+                    if (request.cacheable) {
+                        resultCache.put(request.input, request.filter, request.flags, result);
+                    }
+                    request.future.complete(result);
+                } catch (JqException | JqTimeoutException e) {
+                    loan.close();
+                    request.future.completeExceptionally(e);
+                } catch (Throwable t) {
+                    // anything else may have left the reactor broken
+                    loan.discard();
+                    request.future.completeExceptionally(t);
+                }
+            });
+        } catch (RejectedExecutionException e) {
+            loan.close();
+            request.future.completeExceptionally(e);
+        }
+    }
+
+    private byte[] execute(Loan loan, byte[] input, byte[] filter, int flags) {
+        var reactor = loan.jq().reactor();
+        reactor.setTimeout(callTimeout);
+        return reactor.process(input, filter, flags);
+    }
+
+    private void destroy(JqReactor.Builder builder) {
+        live.decrementAndGet();
+        Integer pages = footprints.remove(builder);
+        if (pages != null) {
+            totalPages.add(-pages);
+        }
+        builder.close();
+    }
+
+    /* ── background maintenance ────────────────────────────────────── */
+
+    private void scheduleRefill() {
+        if (maintenance == null || minIdle == 0 || closed.get()
+                || idleCount() >= minIdle || !refillPending.compareAndSet(false, true)) {
+            return;
+        }
+        try {
+            maintenance.execute(this::refill);
+        } catch (RejectedExecutionException e) {
+            // shut down by close()
+            refillPending.set(false);
+        }
+    }
+
+    private void refill() {
+        refillPending.set(false);
+        try {
+            prewarm(minIdle);
+        } catch (RuntimeException e) {
+            // the next borrow or release schedules another attempt
+        }
+    }
+
+    private void evictExpired() {
+        long now = System.nanoTime();
+        if (slots != null) {
+            for (int i = 0; i < slots.length() && idleCount() > minIdle; i += SLOT_STRIDE) {
+                IdleReactor parked = slots.get(i);
+                if (parked != null && now - parked.since >= idleTimeoutNanos
+                        && slots.compareAndSet(i, parked, null)) {
+                    destroy(parked.builder);
+                    permits.release();
+                }
+            }
+        }
+        while (idle.size() > minIdle) {
+            IdleReactor oldest = idle.pollLast();
+            if (oldest == null) {
+                return;
+            }
+            if (now - oldest.since < idleTimeoutNanos) {
+                idle.offerLast(oldest);
+                return;
+            }
+            destroy(oldest.builder);
+        }
     }
 
     /**
@@ -109,10 +958,377 @@ public final class JqReactorPool implements AutoCloseable {
     @Override
     public void close() {
         if (closed.compareAndSet(false, true)) {
-            JqReactor.Builder b;
-            while ((b = idle.pollFirst()) != null) {
-                b.close();
+            if (maintenance != null) {
+                maintenance.shutdownNow();
+            }
+            Waiter request;
+            while ((request = waiters.poll()) != null) {
+                queued.decrementAndGet();
+                request.future.completeExceptionally(new IllegalStateException("Pool is closed"));
+            }
+            IdleReactor entry;
+            while ((entry = idle.pollFirst()) != null) {
+                destroy(entry.builder);
+            }
+            if (slots != null) {
+                for (int i = 0; i < slots.length(); i += SLOT_STRIDE) {
+                    entry = slots.getAndSet(i, null);
+                    if (entry != null) {
+                        destroy(entry.builder);
+                        permits.release();
+                    }
+                }
+            }
+        }
+    }
+
+    /* a submit() request waiting for a reactor */
+    private static final class Waiter {
+        private final byte[] input;
+        private final byte[] filter;
+        private final int flags;
+        private final boolean cacheable;
+        private final CompletableFuture<byte[]> future = new CompletableFuture<>();
+
+        Waiter(byte[] input, byte[] filter, int flags, boolean cacheable) {
+            this.input = input;
+            this.filter = filter;
+            this.flags = flags;
+            this.cacheable = cacheable;
+        }
+    }
+
+    /* idle reactors remember when they were returned, for idle timeout */
+    private static final class IdleReactor {
+        private final JqReactor.Builder builder;
+        private final long since;
+
+        IdleReactor(JqReactor.Builder builder, long since) {
+            this.builder = builder;
+            this.since = since;
+        }
+    }
+
+    /**
+     * Configures a {@link JqReactorPool}.
+     */
+    public static final class Builder {
+        private int maxSize;
+        private Supplier<JqReactor.Builder> factory = JqReactor::build;
+        private int maxMemoryPages;
+        private int minIdle;
+        private Duration idleTimeout;
+        private boolean threadAffinity;
+        private boolean collectStats;
+        private boolean collectMemoryStats;
+        private Duration callTimeout;
+        private int maxQueueDepth = Integer.MAX_VALUE;
+        private Executor executor = ForkJoinPool.commonPool();
+        private long resultCacheBytes;
+
+        private Builder() {}
+
+        /** Maximum number of reactors that can be borrowed at once. */
+        public Builder withMaxSize(int maxSize) {
+            this.maxSize = maxSize;
+            return this;
+        }
+
+        /**
+         * Creates pooled reactors with {@code factory} instead of
+         * {@link JqReactor#build()}, e.g. to apply reactor settings such
+         * as {@link JqReactor.Builder#withBufferRetention(int)}.
+         */
+        public Builder withReactorFactory(Supplier<JqReactor.Builder> factory) {
+            this.factory = Objects.requireNonNull(factory);
+            return this;
+        }
+
+        /**
+         * Recycles a returned reactor instead of keeping it idle when its
+         * linear memory has grown past {@code pages} 64KiB pages
+         * ({@code 0}, the default, never recycles).
+         */
+        public Builder withMaxMemoryPages(int pages) {
+            if (pages < 0) {
+                throw new IllegalArgumentException("pages must not be negative, got: " + pages);
+            }
+            this.maxMemoryPages = pages;
+            return this;
+        }
+
+        /**
+         * Keeps at least {@code minIdle} reactors ready: a background
+         * thread creates replacements whenever borrows, discards or
+         * recycling take the idle count below it.  Also the default
+         * target of {@link JqReactorPool#prewarm()}.
+         */
+        public Builder withMinIdle(int minIdle) {
+            if (minIdle < 0) {
+                throw new IllegalArgumentException("minIdle must not be negative, got: " + minIdle);
+            }
+            this.minIdle = minIdle;
+            return this;
+        }
+
+        /**
+         * Closes reactors that stayed idle longer than {@code timeout},
+         * down to {@code minIdle}, to give memory back in quiet periods.
+         */
+        public Builder withIdleTimeout(Duration timeout) {
+            if (timeout.isNegative() || timeout.isZero()) {
+                throw new IllegalArgumentException("timeout must be positive, got: " + timeout);
+            }
+            this.idleTimeout = timeout;
+            return this;
+        }
+
+        /**
+         * Parks returned reactors in per-thread slots instead of the
+         * shared deque, so a thread that borrows repeatedly gets the same
+         * reactor back without contention; threads that miss steal from
+         * other slots.  Pays off with many platform threads running a
+         * stable set of filters.
+         */
+        public Builder withThreadAffinity() {
+            this.threadAffinity = true;
+            return this;
+        }
+
+        /**
+         * Bounds how many {@link JqReactorPool#submit} requests may wait
+         * for a reactor; further requests fail fast with
+         * {@link RejectedExecutionException} (default: unbounded).
+         */
+        public Builder withMaxQueueDepth(int depth) {
+            if (depth < 0) {
+                throw new IllegalArgumentException("depth must not be negative, got: " + depth);
+            }
+            this.maxQueueDepth = depth;
+            return this;
+        }
+
+        /**
+         * Runs {@link JqReactorPool#submit} requests on {@code executor}
+         * instead of {@link ForkJoinPool#commonPool()}.  Filters are CPU
+         * bound, so this should not be an event loop.
+         */
+        public Builder withExecutor(Executor executor) {
+            this.executor = Objects.requireNonNull(executor);
+            return this;
+        }
+
+        /**
+         * Keeps the outputs of successful {@link JqReactorPool#submit}
+         * and {@link JqReactorPool#process} requests, up to
+         * {@code maxBytes} of filters, inputs and outputs in total, and
+         * answers identical requests from them without a reactor.  Only
+         * for filters whose output depends on nothing but their input:
+         * not {@code now}, {@code $ENV} or {@code input_filename}.
+         */
+        public Builder withResultCache(long maxBytes) {
+            if (maxBytes < 0) {
+                throw new IllegalArgumentException("maxBytes must not be negative, got: " + maxBytes);
             }
+            this.resultCacheBytes = maxBytes;
+            return this;
+        }
+
+        /**
+         * Bounds every {@link JqReactorPool#process},
+         * {@link JqReactorPool#submit} and
+         * {@link JqReactorPool#processParallel} call like
+         * {@link JqReactor#setTimeout(Duration)}.  After a timeout the
+         * reactor goes back to the pool, unless the call had to be
+         * interrupted, in which case it is replaced.
+         */
+        public Builder withCallTimeout(Duration timeout) {
+            if (timeout.isNegative() || timeout.isZero()) {
+                throw new IllegalArgumentException("timeout must be positive, got: " + timeout);
+            }
+            this.callTimeout = timeout;
+            return this;
+        }
+
+        /**
+         * Enables per-call timing on pooled reactors and aggregates it
+         * into {@link JqReactorPool#stats()}.  Replaces any stats
+         * listener set by the reactor factory.
+         */
+        public Builder withStats() {
+            this.collectStats = true;
+            return this;
+        }
+
+        /**
+         * Records every reactor's memory footprint as it is returned, for
+         * {@link JqReactorPool#memoryStats()}.  Costs a guest call per
+         * return.
+         */
+        public Builder withMemoryStats() {
+            this.collectMemoryStats = true;
+            return this;
+        }
+
+        public JqReactorPool build() {
+            if (maxSize <= 0) {
+                throw new IllegalArgumentException("maxSize must be positive, got: " + maxSize);
+            }
+            if (minIdle > maxSize) {
+                throw new IllegalArgumentException(
+                        "minIdle must not exceed maxSize, got: " + minIdle + " > " + maxSize);
+            }
+            return new JqReactorPool(this);
+        }
+    }
+
+    /* contention-free counters, reactors report from their own threads */
+    private static final class StatsTotals {
+        private final LongAdder calls = new LongAdder();
+        private final LongAdder compileNanos = new LongAdder();
+        private final LongAdder parseNanos = new LongAdder();
+        private final LongAdder executeNanos = new LongAdder();
+        private final LongAdder dumpNanos = new LongAdder();
+        private final LongAdder copyInNanos = new LongAdder();
+        private final LongAdder copyOutNanos = new LongAdder();
+        private final LongAdder bytesIn = new LongAdder();
+        private final LongAdder bytesOut = new LongAdder();
+        private final LongAdder results = new LongAdder();
+
+        void add(JqReactor.CallStats stats) {
+            calls.add(stats.calls());
+            compileNanos.add(stats.compileNanos());
+            parseNanos.add(stats.parseNanos());
+            executeNanos.add(stats.executeNanos());
+            dumpNanos.add(stats.dumpNanos());
+            copyInNanos.add(stats.copyInNanos());
+            copyOutNanos.add(stats.copyOutNanos());
+            bytesIn.add(stats.bytesIn());
+            bytesOut.add(stats.bytesOut());
+            results.add(stats.results());
+        }
+
+        JqReactor.CallStats sum() {
+            return new JqReactor.CallStats(
+                    calls.sum(),
+                    compileNanos.sum(),
+                    parseNanos.sum(),
+                    executeNanos.sum(),
+                    dumpNanos.sum(),
+                    copyInNanos.sum(),
+                    copyOutNanos.sum(),
+                    bytesIn.sum(),
+                    bytesOut.sum(),
+                    results.sum());
+        }
+    }
+
+    /**
+     * Snapshot of the result cache counters, see
+     * {@link JqReactorPool#resultCacheStats()}.
+     */
+    public static final class ResultCacheStats {
+        private final long hits;
+        private final long misses;
+        private final long evictions;
+        private final long entries;
+        private final long bytes;
+
+        ResultCacheStats(long hits, long misses, long evictions, long entries, long bytes) {
+            this.hits = hits;
+            this.misses = misses;
+            this.evictions = evictions;
+            this.entries = entries;
+            this.bytes = bytes;
+        }
+
+        public long hits() {
+            return hits;
+        }
+
+        public long misses() {
+            return misses;
+        }
+
+        public long evictions() {
+            return evictions;
+        }
+
+        /** Results currently cached. */
+        public long entries() {
+            return entries;
+        }
+
+        /** Bytes currently held, including per-entry overhead. */
+        public long bytes() {
+            return bytes;
+        }
+
+        /** Share of lookups answered from the cache, 0 before any lookup. */
+        public double hitRatio() {
+            long lookups = hits + misses;
+            return lookups == 0 ? 0 : (double) hits / lookups;
+        }
+
+        @Override
+        public String toString() {
+            return "ResultCacheStats{hits=" + hits
+                    + ", misses=" + misses
+                    + ", evictions=" + evictions
+                    + ", entries=" + entries
+                    + ", bytes=" + bytes
+                    + "}";
+        }
+    }
+
+    /**
+     * Snapshot of the pool's memory counters, see
+     * {@link JqReactorPool#memoryStats()}.
+     */
+    public static final class MemoryStats {
+        private final int reactors;
+        private final long totalPages;
+        private final int maxReactorPages;
+        private final long peakInUseBytes;
+
+        MemoryStats(int reactors, long totalPages, int maxReactorPages, long peakInUseBytes) {
+            this.reactors = reactors;
+            this.totalPages = totalPages;
+            this.maxReactorPages = maxReactorPages;
+            this.peakInUseBytes = peakInUseBytes;
+        }
+
+        /** Live reactors, idle or lent out. */
+        public int reactors() {
+            return reactors;
+        }
+
+        /** Linear memory of all live reactors, in 64KiB pages. */
+        public long totalPages() {
+            return totalPages;
+        }
+
+        /** Largest linear memory any reactor of this pool has had. */
+        public int maxReactorPages() {
+            return maxReactorPages;
+        }
+
+        /**
+         * Most live guest heap any reactor of this pool has had.
+         *
+         * @see JqReactor.HeapStats#peakInUseBytes()
+         */
+        public long peakInUseBytes() {
+            return peakInUseBytes;
+        }
+
+        @Override
+        public String toString() {
+            return "MemoryStats{reactors=" + reactors
+                    + ", totalPages=" + totalPages
+                    + ", maxReactorPages=" + maxReactorPages
+                    + ", peakInUseBytes=" + peakInUseBytes
+                    + "}";
         }
     }
 
@@ -127,12 +1343,20 @@ public final class JqReactorPool implements AutoCloseable {
     public static final class Loan implements AutoCloseable {
         private final JqReactorPool pool;
         private JqReactor.Builder builder;
+        /* holds a permit and a live count, but run() has yet to create the reactor */
+        private boolean reserved;
 
         Loan(JqReactorPool pool, JqReactor.Builder builder) {
             this.pool = pool;
             this.builder = builder;
         }
 
+        static Loan reserved(JqReactorPool pool) {
+            var loan = new Loan(pool, null);
+            loan.reserved = true;
+            return loan;
+        }
+
         /**
          * Returns the borrowed builder for configuring and running a
          * jq filter.
@@ -155,6 +1379,9 @@ public final class JqReactorPool implements AutoCloseable {
             if (builder != null) {
                 pool.release(builder);
                 builder = null;
+            } else if (reserved) {
+                reserved = false;
+                pool.unreserve();
             }
         }
 
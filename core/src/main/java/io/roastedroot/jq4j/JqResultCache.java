@@ -0,0 +1,164 @@
+package io.roastedroot.jq4j;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentLinkedQueue;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Outputs of successful (filter, flags, input) runs, bounded by the total
+ * bytes they hold, for {@link JqReactorPool}.
+ *
+ * <p>Entries are found by a 64-bit hash of the request and confirmed by
+ * comparing the stored filter and input, so a hash collision can never
+ * hand one request another's output.  Eviction is CLOCK: a hit only sets
+ * a flag, and the evicting thread gives flagged entries a second pass,
+ * so lookups never take a lock or reorder a list.
+ */
+final class JqResultCache {
+
+    private static final VarHandle WORDS =
+            MethodHandles.byteArrayViewVarHandle(long[].class, ByteOrder.LITTLE_ENDIAN);
+
+    /* xxHash64 primes, for the per-word round and the seed */
+    private static final long PRIME1 = 0x9E3779B185EBCA87L;
+    private static final long PRIME2 = 0xC2B2AE3D27D4EB4FL;
+
+    /* rough per-entry cost of the key, entry and map node objects */
+    private static final int ENTRY_OVERHEAD = 128;
+
+    private final long maxBytes;
+    private final ConcurrentHashMap<Key, Entry> entries = new ConcurrentHashMap<>();
+    private final ConcurrentLinkedQueue<Key> clock = new ConcurrentLinkedQueue<>();
+    private final AtomicLong bytes = new AtomicLong();
+    private final LongAdder hits = new LongAdder();
+    private final LongAdder misses = new LongAdder();
+    private final LongAdder evictions = new LongAdder();
+
+    JqResultCache(long maxBytes) {
+        this.maxBytes = maxBytes;
+    }
+
+    /** A copy of the cached output, or {@code null} on a miss. */
+    byte[] get(byte[] input, byte[] filter, int flags) {
+        Entry entry = entries.get(new Key(input, filter, flags));
+        if (entry == null) {
+            misses.increment();
+            return null;
+        }
+        entry.referenced = true;
+        hits.increment();
+        return entry.output.clone();
+    }
+
+    void put(byte[] input, byte[] filter, int flags, byte[] output) {
+        long size = (long) input.length + filter.length + output.length + ENTRY_OVERHEAD;
+        if (size > maxBytes) {
+            return;
+        }
+        var key = new Key(input.clone(), filter.clone(), flags);
+        if (entries.putIfAbsent(key, new Entry(output.clone(), size)) == null) {
+            clock.offer(key);
+            if (bytes.addAndGet(size) > maxBytes) {
+                evict();
+            }
+        }
+    }
+
+    private void evict() {
+        while (bytes.get() > maxBytes) {
+            Key key = clock.poll();
+            if (key == null) {
+                return;
+            }
+            Entry entry = entries.get(key);
+            if (entry == null) {
+                continue;
+            }
+            if (entry.referenced) {
+                entry.referenced = false;
+                clock.offer(key);
+            } else if (entries.remove(key, entry)) {
+                bytes.addAndGet(-entry.size);
+                evictions.increment();
+            }
+        }
+    }
+
+    JqReactorPool.ResultCacheStats stats() {
+        return new JqReactorPool.ResultCacheStats(
+                hits.sum(), misses.sum(), evictions.sum(), entries.size(), bytes.get());
+    }
+
+    static long hash(byte[] input, byte[] filter, int flags) {
+        long h = hash(PRIME1 ^ flags, filter);
+        return hash(h, input);
+    }
+
+    private static long hash(long seed, byte[] data) {
+        long h = seed;
+        int i = 0;
+        for (; i + Long.BYTES <= data.length; i += Long.BYTES) {
+            h = round(h, (long) WORDS.get(data, i));
+        }
+        long tail = 0;
+        for (int j = data.length - 1; j >= i; j--) {
+            tail = tail << 8 | (data[j] & 0xFF);
+        }
+        h = round(h, tail) ^ data.length;
+        // murmur3 fmix64, so every input bit reaches every hash bit
+        h = (h ^ (h >>> 33)) * 0xFF51AFD7ED558CCDL;
+        h = (h ^ (h >>> 33)) * 0xC4CEB9FE1A85EC53L;
+        return h ^ (h >>> 33);
+    }
+
+    private static long round(long h, long word) {
+        return Long.rotateLeft(h ^ word * PRIME2, 31) * PRIME1;
+    }
+
+    private static final class Key {
+        private final byte[] input;
+        private final byte[] filter;
+        private final int flags;
+        private final long hash;
+
+        Key(byte[] input, byte[] filter, int flags) {
+            this.input = input;
+            this.filter = filter;
+            this.flags = flags;
+            this.hash = JqResultCache.hash(input, filter, flags);
+        }
+
+        @Override
+        public boolean equals(Object o) {
+            if (!(o instanceof Key)) {
+                return false;
+            }
+            var other = (Key) o;
+            return hash == other.hash
+                    && flags == other.flags
+                    && Arrays.equals(filter, other.filter)
+                    && Arrays.equals(input, other.input);
+        }
+
+        @Override
+        public int hashCode() {
+            return Long.hashCode(hash);
+        }
+    }
+
+    private static final class Entry {
+        private final byte[] output;
+        private final long size;
+        private volatile boolean referenced;
+
+        Entry(byte[] output, long size) {
+            this.output = output;
+            this.size = size;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+package io.roastedroot.jq4j;
+
+import java.time.Duration;
+
+/**
+ * A reactor call ran past the timeout set with
+ * {@link JqReactor#setTimeout(Duration)} or
+ * {@link JqReactor.Builder#withTimeout(Duration)}.
+ *
+ * <p>Usually jq stops on its own between results or inputs and the
+ * reactor stays usable.  If it had to be interrupted mid-instruction,
+ * {@link #reactorDiscarded()} is true and the reactor must be closed;
+ * {@link JqReactorPool} replaces it when its loan is returned.
+ */
+public final class JqTimeoutException extends RuntimeException {
+
+    private static final long serialVersionUID = 1L;
+
+    private final Duration timeout;
+    private final boolean reactorDiscarded;
+
+    JqTimeoutException(Duration timeout, boolean reactorDiscarded, Throwable cause) {
+        super("jq call exceeded its timeout of " + timeout.toMillis() + "ms", cause);
+        this.timeout = timeout;
+        this.reactorDiscarded = reactorDiscarded;
+    }
+
+    public Duration timeout() {
+        return timeout;
+    }
+
+    /**
+     * Whether the reactor was left unusable by the interruption.
+     */
+    public boolean reactorDiscarded() {
+        return reactorDiscarded;
+    }
+}
@@ -0,0 +1,142 @@
+package io.roastedroot.jq4j;
+
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.VarHandle;
+import java.nio.ByteOrder;
+
+/**
+ * Finds top-level value boundaries in a stream of JSON texts without
+ * parsing it, so the stream can be cut into independently processable
+ * chunks.  Only strings, escapes and bracket depth are tracked; anything
+ * malformed is left for jq's parser to report.
+ *
+ * <p>Inside strings and nested values, where almost every byte is
+ * uninteresting, the input is scanned eight bytes at a time: each word is
+ * tested for the few bytes that can change state with SWAR bit tricks,
+ * and only those are visited one by one.
+ *
+ * <p>State carries over between calls, so a stream can be scanned in
+ * consecutive pieces.
+ */
+final class JsonStructuralScanner {
+
+    private static final VarHandle WORDS =
+            MethodHandles.byteArrayViewVarHandle(long[].class, ByteOrder.LITTLE_ENDIAN);
+
+    private static final long ONES = 0x0101010101010101L;
+    private static final long LOW7 = 0x7F7F7F7F7F7F7F7FL;
+    private static final long QUOTES = '"' * ONES;
+    private static final long BACKSLASHES = '\\' * ONES;
+    private static final long OPENERS = '{' * ONES;
+    private static final long CLOSERS = '}' * ONES;
+    private static final long CASE_BIT = 0x20 * ONES;
+
+    private int depth;
+    private boolean inString;
+    private boolean escaped;
+    private boolean inValue;
+    private long values;
+
+    /**
+     * Scans {@code buf[from, to)} and returns the offset just past the
+     * first place where one top-level value has ended — after a closing
+     * bracket back at depth zero, or after whitespace ending a top-level
+     * scalar — or {@code -1} if there is none in that range.
+     */
+    int nextBoundary(byte[] buf, int from, int to) {
+        int i = from;
+        while (i < to) {
+            if (!escaped && (inString || depth > 0) && to - i >= Long.BYTES) {
+                long word = (long) WORDS.get(buf, i);
+                long specials = inString ? stringSpecials(word) : nestedSpecials(word);
+                if (specials == 0) {
+                    i += Long.BYTES;
+                    continue;
+                }
+                i += Long.numberOfTrailingZeros(specials) >>> 3;
+            }
+            if (step(buf[i++])) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Number of top-level values started so far.  At a boundary returned
+     * by {@link #nextBoundary} this is the number of values before it.
+     */
+    long values() {
+        return values;
+    }
+
+    /* advances the state by one byte, true if a top-level value ended on it */
+    private boolean step(byte b) {
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (b == '\\') {
+                escaped = true;
+            } else if (b == '"') {
+                inString = false;
+            }
+            return false;
+        }
+        switch (b) {
+            case '"':
+                startValue();
+                inString = true;
+                return false;
+            case '{':
+            case '[':
+                startValue();
+                depth++;
+                return false;
+            case '}':
+            case ']':
+                if (depth > 0 && --depth == 0) {
+                    inValue = false;
+                    return true;
+                }
+                return false;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                if (depth == 0 && inValue) {
+                    inValue = false;
+                    return true;
+                }
+                return false;
+            default:
+                startValue();
+                return false;
+        }
+    }
+
+    private void startValue() {
+        if (depth == 0 && !inValue) {
+            inValue = true;
+            values++;
+        }
+    }
+
+    /* high bit set in every byte of the word that is a quote or a backslash */
+    private static long stringSpecials(long word) {
+        return zeroBytes(word ^ QUOTES) | zeroBytes(word ^ BACKSLASHES);
+    }
+
+    /*
+     * high bit set in every byte that is a quote or a bracket; '[' and ']'
+     * differ from '{' and '}' only in bit 5, so two compares cover all four
+     */
+    private static long nestedSpecials(long word) {
+        long folded = word | CASE_BIT;
+        return zeroBytes(word ^ QUOTES) | zeroBytes(folded ^ OPENERS) | zeroBytes(folded ^ CLOSERS);
+    }
+
+    /* high bit set in exactly the bytes of x that are zero, no false positives */
+    private static long zeroBytes(long x) {
+        return ~(((x & LOW7) + LOW7) | x | LOW7);
+    }
+}
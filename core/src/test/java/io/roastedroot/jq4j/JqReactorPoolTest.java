@@ -2,18 +2,28 @@ package io.roastedroot.jq4j;
 
 import static java.nio.charset.StandardCharsets.UTF_8;
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertNotNull;
+import static org.junit.jupiter.api.Assertions.assertNotSame;
+import static org.junit.jupiter.api.Assertions.assertNull;
+import static org.junit.jupiter.api.Assertions.assertSame;
 import static org.junit.jupiter.api.Assertions.assertThrows;
+import static org.junit.jupiter.api.Assertions.assertTrue;
 
+import java.time.Duration;
 import java.util.ArrayList;
 import java.util.Collections;
 import java.util.List;
 import java.util.concurrent.BrokenBarrierException;
 import java.util.concurrent.CyclicBarrier;
+import java.util.concurrent.ExecutionException;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
 import java.util.concurrent.Future;
+import java.util.concurrent.RejectedExecutionException;
 import java.util.concurrent.TimeUnit;
 import java.util.concurrent.TimeoutException;
+import java.util.concurrent.atomic.AtomicInteger;
 import org.junit.jupiter.api.Test;
 
 public class JqReactorPoolTest {
@@ -133,6 +143,33 @@ public class JqReactorPoolTest {
         pool.close();
     }
 
+    @Test
+    public void oversizedReactorIsRecycled() throws Exception {
+        var pool = JqReactorPool.builder()
+                .withMaxSize(1)
+                .withReactorFactory(() -> JqReactor.build().withBufferRetention(64 * 1024))
+                .withMaxMemoryPages(1)
+                .build();
+
+        JqReactor firstReactor;
+        try (var loan = pool.borrow()) {
+            firstReactor = loan.jq().reactor;
+            loan.jq().withInput("[]").withFilter(".").run();
+        }
+
+        try (var loan = pool.borrow()) {
+            assertNotSame(firstReactor, loan.jq().reactor);
+            byte[] result = loan.jq()
+                    .withInput("{\"ok\":true}")
+                    .withFilter(".ok")
+                    .withCompactOutput()
+                    .run();
+            assertEquals("true\n", new String(result, UTF_8));
+        }
+
+        pool.close();
+    }
+
     @Test
     public void borrowAfterCloseThrows() throws Exception {
         var pool = JqReactorPool.create(2);
@@ -146,4 +183,328 @@ public class JqReactorPoolTest {
         assertThrows(IllegalArgumentException.class, () -> JqReactorPool.create(0));
         assertThrows(IllegalArgumentException.class, () -> JqReactorPool.create(-1));
     }
+
+    @Test
+    public void statsAreAggregatedAcrossReactors() throws Exception {
+        try (var pool = JqReactorPool.builder().withMaxSize(2).withStats().build()) {
+            for (int i = 0; i < 3; i++) {
+                try (var loan = pool.borrow()) {
+                    loan.jq().withInput("[1, 2]").withFilter(".[]").run();
+                }
+            }
+
+            var stats = pool.stats();
+            assertEquals(3, stats.calls());
+            assertEquals(6, stats.results());
+        }
+    }
+
+    @Test
+    public void prewarmFillsMinIdle() {
+        try (var pool = JqReactorPool.builder().withMaxSize(4).withMinIdle(2).build()) {
+            pool.prewarm();
+
+            assertEquals(2, pool.idleCount());
+        }
+    }
+
+    @Test
+    public void minIdleIsRefilledInBackground() throws Exception {
+        try (var pool = JqReactorPool.builder().withMaxSize(2).withMinIdle(1).build()) {
+            pool.prewarm();
+            var loan = pool.borrow();
+            awaitIdleCount(pool, 1);
+            loan.close();
+        }
+    }
+
+    @Test
+    public void idleReactorsAreEvictedAfterTimeout() throws Exception {
+        try (var pool = JqReactorPool.builder()
+                .withMaxSize(2)
+                .withIdleTimeout(Duration.ofMillis(50))
+                .build()) {
+            var first = pool.borrow();
+            var second = pool.borrow();
+            first.close();
+            second.close();
+
+            awaitIdleCount(pool, 0);
+        }
+    }
+
+    @Test
+    public void threadAffinityReturnsTheSameReactor() throws Exception {
+        try (var pool = JqReactorPool.builder().withMaxSize(2).withThreadAffinity().build()) {
+            JqReactor.Builder first;
+            try (var loan = pool.borrow()) {
+                first = loan.jq();
+            }
+            try (var loan = pool.borrow()) {
+                assertSame(first, loan.jq());
+            }
+        }
+    }
+
+    @Test
+    public void threadAffinityStealsParkedReactors() throws Exception {
+        try (var pool = JqReactorPool.builder().withMaxSize(1).withThreadAffinity().build()) {
+            JqReactor.Builder parked;
+            try (var loan = pool.borrow()) {
+                parked = loan.jq();
+            }
+
+            // the only permit is parked with this thread's slot
+            ExecutorService executor = Executors.newSingleThreadExecutor();
+            try {
+                Future<JqReactor.Builder> stolen = executor.submit(() -> {
+                    try (var loan = pool.borrow()) {
+                        return loan.jq();
+                    }
+                });
+                assertSame(parked, stolen.get(30, TimeUnit.SECONDS));
+            } finally {
+                executor.shutdownNow();
+            }
+        }
+    }
+
+    @Test
+    public void parkedReactorsCountTowardsMinIdle() throws Exception {
+        var created = new AtomicInteger();
+        try (var pool = JqReactorPool.builder()
+                .withMaxSize(4)
+                .withMinIdle(1)
+                .withThreadAffinity()
+                .withReactorFactory(() -> {
+                    created.incrementAndGet();
+                    return JqReactor.build();
+                })
+                .build()) {
+            pool.prewarm();
+            for (int i = 0; i < 10; i++) {
+                try (var loan = pool.borrow()) {
+                    loan.jq().withInput("1").withFilter(".").run();
+                }
+            }
+            Thread.sleep(200);
+
+            // one refill while the first loan was out, none once it was parked
+            assertTrue(created.get() <= 2, "created " + created.get());
+            assertTrue(pool.idleCount() <= 2);
+        }
+    }
+
+    @Test
+    public void submitCompletesWithResult() throws Exception {
+        try (var pool = JqReactorPool.create(2)) {
+            var result = pool.submit("{\"a\":1}".getBytes(UTF_8), ".a".getBytes(UTF_8), 0);
+
+            assertEquals("1\n", new String(result.get(30, TimeUnit.SECONDS), UTF_8));
+        }
+    }
+
+    @Test
+    public void submitCreatesReactorsOnTheExecutor() throws Exception {
+        List<String> creators = Collections.synchronizedList(new ArrayList<>());
+        ExecutorService executor = Executors.newSingleThreadExecutor(r -> new Thread(r, "jq-submit"));
+        try (var pool = JqReactorPool.builder()
+                .withMaxSize(1)
+                .withReactorFactory(() -> {
+                    creators.add(Thread.currentThread().getName());
+                    return JqReactor.build();
+                })
+                .withExecutor(executor)
+                .build()) {
+            var result = pool.submit("1".getBytes(UTF_8), ".".getBytes(UTF_8), 0);
+            assertEquals("1\n", new String(result.get(30, TimeUnit.SECONDS), UTF_8));
+            assertEquals(List.of("jq-submit"), creators);
+        } finally {
+            executor.shutdownNow();
+        }
+    }
+
+    @Test
+    public void submitWaitsForReturnedReactorAndRejectsOverflow() throws Exception {
+        try (var pool = JqReactorPool.builder().withMaxSize(1).withMaxQueueDepth(1).build()) {
+            var loan = pool.borrow();
+            var queued = pool.submit("2".getBytes(UTF_8), ". + 1".getBytes(UTF_8), 0);
+            var rejected = pool.submit("2".getBytes(UTF_8), ". + 1".getBytes(UTF_8), 0);
+
+            var failure = assertThrows(ExecutionException.class, rejected::get);
+            assertTrue(failure.getCause() instanceof RejectedExecutionException);
+            assertEquals(1, pool.queuedCount());
+
+            loan.close();
+            assertEquals("3\n", new String(queued.get(30, TimeUnit.SECONDS), UTF_8));
+        }
+    }
+
+    @Test
+    public void tryBorrowTimesOut() throws Exception {
+        try (var pool = JqReactorPool.create(1)) {
+            var loan = pool.borrow();
+            assertNull(pool.tryBorrow(Duration.ZERO));
+            assertNull(pool.tryBorrow(Duration.ofMillis(20)));
+
+            loan.close();
+            try (var again = pool.tryBorrow(Duration.ofSeconds(30))) {
+                assertNotNull(again);
+            }
+        }
+    }
+
+    @Test
+    public void callTimeoutOnlyReplacesInterruptedReactors() throws Exception {
+        byte[] input = "null".getBytes(UTF_8);
+        try (var pool = JqReactorPool.builder()
+                .withMaxSize(1)
+                .withCallTimeout(Duration.ofMillis(100))
+                .build()) {
+            JqReactor first;
+            try (var loan = pool.borrow()) {
+                first = loan.jq().reactor;
+            }
+
+            // repeat yields between results, so jq stops by itself
+            var stopped = assertThrows(
+                    JqTimeoutException.class,
+                    () -> pool.process(input, "repeat(1)".getBytes(UTF_8), 0));
+            assertFalse(stopped.reactorDiscarded());
+            try (var loan = pool.borrow()) {
+                assertSame(first, loan.jq().reactor);
+            }
+
+            // last(repeat(.)) never yields and has to be interrupted
+            var failure = assertThrows(
+                    ExecutionException.class,
+                    () -> pool.submit(input, "last(repeat(.))".getBytes(UTF_8), 0).get());
+            var interrupted = (JqTimeoutException) failure.getCause();
+            assertTrue(interrupted.reactorDiscarded());
+            try (var loan = pool.borrow()) {
+                assertNotSame(first, loan.jq().reactor);
+            }
+            byte[] after = pool.process("1".getBytes(UTF_8), ".".getBytes(UTF_8), 0);
+            assertEquals("1\n", new String(after, UTF_8));
+        }
+    }
+
+    @Test
+    public void memoryStatsFollowLiveReactors() throws Exception {
+        try (var untracked = JqReactorPool.create(1)) {
+            untracked.process("1".getBytes(UTF_8), ".".getBytes(UTF_8), 0);
+            assertEquals(0, untracked.memoryStats().reactors());
+        }
+        try (var pool = JqReactorPool.builder().withMaxSize(2).withMemoryStats().build()) {
+            try (var a = pool.borrow(); var b = pool.borrow()) {
+                a.jq().withInput("[" + "1,".repeat(100_000) + "1]").withFilter("length").run();
+            }
+            var stats = pool.memoryStats();
+            assertEquals(2, stats.reactors());
+            assertTrue(stats.maxReactorPages() > 0);
+            assertTrue(stats.totalPages() > stats.maxReactorPages());
+            assertTrue(stats.peakInUseBytes() > 0);
+        }
+    }
+
+    @Test
+    public void resultCacheAnswersRepeatedRequests() throws Exception {
+        byte[] input = "{\"a\": 1}".getBytes(UTF_8);
+        byte[] filter = ".a".getBytes(UTF_8);
+        try (var pool = JqReactorPool.builder().withMaxSize(1).withResultCache(1 << 20).build()) {
+            assertEquals("1\n", new String(pool.process(input, filter, 0), UTF_8));
+            assertEquals("1\n", new String(pool.submit(input.clone(), filter, 0).get(), UTF_8));
+            assertEquals("1\n", new String(pool.process(input, filter, JqReactor.FLAG_COMPACT), UTF_8));
+
+            try (var loan = pool.borrow()) {
+                // served from the cache while the only reactor is lent out
+                assertEquals("1\n", new String(pool.process(input, filter, 0), UTF_8));
+            }
+
+            var stats = pool.resultCacheStats();
+            assertEquals(2, stats.hits());
+            assertEquals(2, stats.misses());
+            assertEquals(2, stats.entries());
+            assertEquals(0.5, stats.hitRatio());
+        }
+    }
+
+    @Test
+    public void processParallelKeepsInputOrder() {
+        var input = new StringBuilder();
+        var expected = new StringBuilder();
+        for (int i = 0; i < 200_000; i++) {
+            input.append("{\"id\":").append(i).append(",\"tag\":\"a \\\" } b\"}\n");
+            expected.append(i).append('\n');
+        }
+        try (var pool = JqReactorPool.create(4)) {
+            byte[] result = pool.processParallel(
+                    input.toString().getBytes(UTF_8), ".id".getBytes(UTF_8), 0);
+
+            assertEquals(expected.toString(), new String(result, UTF_8));
+        }
+    }
+
+    @Test
+    public void processParallelRunsChunksWhenTheQueueIsFull() throws Exception {
+        var input = new StringBuilder();
+        var expected = new StringBuilder();
+        for (int i = 0; i < 200_000; i++) {
+            input.append("{\"id\":").append(i).append("}\n");
+            expected.append(i).append('\n');
+        }
+        ExecutorService caller = Executors.newSingleThreadExecutor();
+        try (var pool = JqReactorPool.builder().withMaxSize(1).withMaxQueueDepth(1).build()) {
+            var loan = pool.borrow();
+            var queued = pool.submit("1".getBytes(UTF_8), ".".getBytes(UTF_8), 0);
+            assertEquals(1, pool.queuedCount());
+
+            // every chunk is rejected by the full queue until the loan returns
+            Future<byte[]> result = caller.submit(() -> pool.processParallel(
+                    input.toString().getBytes(UTF_8), ".id".getBytes(UTF_8), 0));
+            Thread.sleep(50);
+            loan.close();
+
+            assertEquals(expected.toString(), new String(result.get(30, TimeUnit.SECONDS), UTF_8));
+            assertEquals("1\n", new String(queued.get(30, TimeUnit.SECONDS), UTF_8));
+        } finally {
+            caller.shutdownNow();
+        }
+    }
+
+    @Test
+    public void processParallelReportsStreamWideInputIndices() {
+        var input = new StringBuilder();
+        for (int i = 0; i < 200_000; i++) {
+            input.append(i == 150_000 ? "\"oops\"" : Integer.toString(i)).append('\n');
+        }
+        try (var pool = JqReactorPool.create(4)) {
+            var failure = assertThrows(JqException.class, () -> pool.processParallel(
+                    input.toString().getBytes(UTF_8), ". + 1".getBytes(UTF_8), 0));
+
+            assertEquals(1, failure.errors().size());
+            assertEquals(150_000, failure.errors().get(0).inputIndex());
+            String output = new String(failure.output(), UTF_8);
+            assertTrue(output.startsWith("1\n2\n"));
+            assertTrue(output.contains("\n150000\n150002\n"));
+            assertTrue(output.endsWith("200000\n"));
+        }
+    }
+
+    @Test
+    public void processParallelRejectsSlurp() {
+        try (var pool = JqReactorPool.create(1)) {
+            assertThrows(IllegalArgumentException.class, () -> pool.processParallel(
+                    "1 2".getBytes(UTF_8), ".".getBytes(UTF_8), JqReactor.FLAG_SLURP));
+        }
+    }
+
+    private static void awaitIdleCount(JqReactorPool pool, int expected)
+            throws InterruptedException {
+        long deadline = System.nanoTime() + TimeUnit.SECONDS.toNanos(30);
+        while (pool.idleCount() != expected && System.nanoTime() < deadline) {
+            Thread.sleep(10);
+        }
+        assertEquals(expected, pool.idleCount());
+    }
 }
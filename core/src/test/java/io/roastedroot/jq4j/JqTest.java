@@ -2,10 +2,24 @@ package io.roastedroot.jq4j;
 
 import static java.nio.charset.StandardCharsets.UTF_8;
 import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertFalse;
+import static org.junit.jupiter.api.Assertions.assertThrows;
 import static org.junit.jupiter.api.Assertions.assertTrue;
 
+import java.io.ByteArrayInputStream;
+import java.io.ByteArrayOutputStream;
 import java.io.IOException;
+import java.io.InputStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.time.Duration;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+import java.util.Map;
 import org.junit.jupiter.api.Test;
+import org.junit.jupiter.api.io.TempDir;
+import run.endive.runtime.ByteArrayMemory;
 
 public class JqTest {
     // Tests mostly from:
@@ -55,6 +69,575 @@ public class JqTest {
         jq.close();
     }
 
+    @Test
+    public void compiledFilter() {
+        // Arrange
+        try (var jq = JqReactor.build();
+                var filter = jq.reactor().compile(".foo")) {
+
+            // Act
+            var first = jq.withInput("{\"foo\": 1}").withFilter(filter).withCompactOutput().run();
+            var second = jq.reactor().process(
+                    "{\"foo\": [2]}".getBytes(UTF_8), filter, JqReactor.FLAG_COMPACT);
+
+            // Assert
+            assertEquals("1\n", new String(first, UTF_8));
+            assertEquals("[2]\n", new String(second, UTF_8));
+            assertEquals(".foo", filter.filter());
+        }
+    }
+
+    @Test
+    public void compiledFilterRejectsInvalidProgram() {
+        try (var jq = JqReactor.build()) {
+            var failure = assertThrows(JqException.class, () -> jq.reactor().compile(".foo |"));
+
+            assertEquals(
+                    JqException.ErrorRecord.NO_INPUT, failure.errors().get(0).inputIndex());
+        }
+    }
+
+    @Test
+    public void runtimeErrorsAreReportedPerInput() {
+        try (var jq = JqReactor.build()) {
+            var failure = assertThrows(JqException.class, () ->
+                    jq.withInput("{\"a\": 1} 2 {\"a\": 3}").withFilter(".a").run());
+
+            assertEquals(1, failure.errors().size());
+            var error = failure.errors().get(0);
+            assertEquals(1, error.inputIndex());
+            assertTrue(error.message().contains("Cannot index number"), error.message());
+            assertEquals("1\n3\n", new String(failure.output(), UTF_8));
+        }
+    }
+
+    @Test
+    public void callStatsAreReported() {
+        var reported = new ArrayList<JqReactor.CallStats>();
+        try (var jq = JqReactor.build().withStatsListener(reported::add)) {
+            var input = "[1, 2]";
+            var result = jq.withInput(input).withFilter(".[]").withCompactOutput().run();
+
+            assertEquals(1, reported.size());
+            var stats = reported.get(0);
+            assertEquals(input.length(), stats.bytesIn());
+            assertEquals(result.length, stats.bytesOut());
+            assertEquals(2, stats.results());
+            assertTrue(stats.executeNanos() > 0, stats.toString());
+        }
+    }
+
+    @Test
+    public void cborOutputDecodesToJavaValues() {
+        try (var jq = JqReactor.build()) {
+            var output = jq.withInput("{\"b\": [1, -2, 2.5, \"x\", null, true], \"a\": {}}")
+                    .withFilter("., .b[1]")
+                    .withSortKeys()
+                    .withCborOutput()
+                    .run();
+
+            var results = JqCbor.decode(output);
+            assertEquals(2, results.size());
+            var object = (Map<?, ?>) results.get(0);
+            assertEquals(List.of("a", "b"), List.copyOf(object.keySet()));
+            assertEquals(Map.of(), object.get("a"));
+            assertEquals(Arrays.asList(1L, -2L, 2.5, "x", null, true), object.get("b"));
+            assertEquals(-2L, results.get(1));
+        }
+    }
+
+    @Test
+    public void rawInputAndOutput() {
+        try (var jq = JqReactor.build()) {
+            var lines = jq.withInput("a\nb \"c\"\n\nlast")
+                    .withFilter("length")
+                    .withRawInput()
+                    .withCompactOutput()
+                    .run();
+            assertEquals("1\n5\n0\n4\n", new String(lines, UTF_8));
+
+            var slurped = jq.withInput("a\nb\n").withFilter(".").withRawInput().withSlurp().run();
+            assertEquals("\"a\\nb\\n\"\n", new String(slurped, UTF_8));
+
+            var raw = jq.withInput("[\"x\", 1]").withFilter(".[]").withRawOutput().run();
+            assertEquals("x\n1\n", new String(raw, UTF_8));
+
+            var joined = jq.withInput("[\"x\", 1]").withFilter(".[]").withJoinOutput().run();
+            assertEquals("x1", new String(joined, UTF_8));
+
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream("one\ntwo".getBytes(UTF_8)),
+                    ".".getBytes(UTF_8),
+                    JqReactor.FLAG_RAW_INPUT | JqReactor.FLAG_RAW_OUTPUT,
+                    out);
+            assertEquals("one\ntwo\n", out.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void streamAndSeqModes() {
+        try (var jq = JqReactor.build()) {
+            var events = jq.withInput("{\"a\": [1]}")
+                    .withFilter(".")
+                    .withStreamInput()
+                    .withCompactOutput()
+                    .run();
+            assertEquals("[[\"a\",0],1]\n[[\"a\",0]]\n[[\"a\"]]\n", new String(events, UTF_8));
+
+            var seq = jq.withInput("\u001e1\n\u001e2\n")
+                    .withFilter(". + 1")
+                    .withSeq()
+                    .run();
+            assertEquals("\u001e2\n\u001e3\n", new String(seq, UTF_8));
+
+            // like jq, a malformed text is dropped up to the next RS
+            var resynced = jq.withInput("\u001e1\n\u001e{\"a\":\n\u001e2\n")
+                    .withFilter(". + 1")
+                    .withSeq()
+                    .run();
+            assertEquals("\u001e2\n\u001e3\n", new String(resynced, UTF_8));
+
+            var projected = jq.withInput("\u001e{\"a\": 1, \"b\": 2}\n")
+                    .withFilter(".a")
+                    .withSeq()
+                    .withPathProjection()
+                    .run();
+            assertEquals("\u001e1\n", new String(projected, UTF_8));
+        }
+    }
+
+    @Test
+    public void namedArguments() {
+        try (var jq = JqReactor.build()) {
+            var first = jq.withInput("null")
+                    .withFilter("[$name, $n, $ARGS.named.n]")
+                    .withArg("name", "a \"quoted\"\nvalue")
+                    .withArgJson("n", "{\"x\": 1}")
+                    .withCompactOutput()
+                    .run();
+            assertEquals("[\"a \\\"quoted\\\"\\nvalue\",{\"x\":1},{\"x\":1}]\n",
+                    new String(first, UTF_8));
+
+            // same filter text, different bindings: must not hit the cached program
+            var second = jq.withInput("null").withFilter("$name").withArg("name", "b").run();
+            assertEquals("\"b\"\n", new String(second, UTF_8));
+            var third = jq.withInput("null").withFilter("$name").withArg("name", "c").run();
+            assertEquals("\"c\"\n", new String(third, UTF_8));
+
+            var positional = jq.withInput("null").withFilter("$ARGS.positional").withCompactOutput().run();
+            assertEquals("[]\n", new String(positional, UTF_8));
+
+            assertThrows(IllegalArgumentException.class, () -> jq.withInput("null")
+                    .withFilter("$n")
+                    .withArgJson("n", "{not json")
+                    .run());
+        }
+    }
+
+    @Test
+    public void pathProjectionMatchesFullParse() {
+        var input = "{\"request\": {\"body\": [1, {\"x-id\": 0}], \"headers\": {\"x-id\": \"a\"}}}\n"
+                + "{\"request\": {\"headers\": {}}, \"pad\": \"} ]\"}\n"
+                + "{\"request\": {\"headers\": {\"x-id\": \"b\", \"x-id\": [\"c\"]}}}\n";
+        try (var jq = JqReactor.build()) {
+            for (var filter : List.of(".request.headers[\"x-id\"]", ".request", ".request | keys")) {
+                var full = jq.withInput(input).withFilter(filter).withCompactOutput().run();
+                var projected = jq.withInput(input)
+                        .withFilter(filter)
+                        .withCompactOutput()
+                        .withPathProjection()
+                        .run();
+                assertEquals(new String(full, UTF_8), new String(projected, UTF_8), filter);
+            }
+
+            var bom = jq.withInput("\uFEFF" + input)
+                    .withFilter(".request.headers[\"x-id\"]")
+                    .withCompactOutput()
+                    .withPathProjection()
+                    .run();
+            assertEquals("\"a\"\nnull\n[\"c\"]\n", new String(bom, UTF_8));
+
+            var failure = assertThrows(JqException.class, () -> jq.withInput("{\"a\": 1} {\"a\": [}")
+                    .withFilter(".a")
+                    .withPathProjection()
+                    .run());
+            assertEquals(1, failure.errors().get(0).inputIndex());
+        }
+    }
+
+    @Test
+    public void forkStartsFromTheTemplateState() {
+        try (var template = JqReactor.build()) {
+            template.withInput("{\"a\": 1}").withFilter(".a").run();
+            long templateHits = template.reactor().filterCacheStats().hits();
+
+            try (var fork = template.fork()) {
+                var result = fork.withInput("{\"a\": 2}").withFilter(".a").run();
+
+                assertEquals("2\n", new String(result, UTF_8));
+                assertEquals(templateHits + 1, fork.reactor().filterCacheStats().hits());
+                assertEquals(templateHits, template.reactor().filterCacheStats().hits());
+            }
+            var again = template.withInput("{\"a\": 3}").withFilter(".a").run();
+            assertEquals("3\n", new String(again, UTF_8));
+        }
+    }
+
+    @Test
+    public void compactOutputMatchesJqCommand() {
+        var input =
+                "{\"s\": \"q\\\" b\\\\ nl\\n tab\\t \\u0001 \\u007f é 𝄞\", "
+                        + "\"n\": [0, -7, 1.50, 1e2, 100000000000000000000, 0.1, 1e1000], "
+                        + "\"b\": {\"z\": true, \"a\": null}, \"e\": [[], {}]}";
+        var filter = "., (.n | map(. * 3)), [.n[] | -.], -0, (1e15, 123456789012345 | . + 0)";
+
+        for (String sort : new String[] {"-c", "-S"}) {
+            var expected =
+                    Jq.builder()
+                            .withStdin(input.getBytes(UTF_8))
+                            .withArgs("-M", "-c", sort, filter)
+                            .run();
+            try (var jq = JqReactor.build()) {
+                jq.withInput(input).withFilter(filter).withCompactOutput();
+                if (sort.equals("-S")) {
+                    jq.withSortKeys();
+                }
+                assertEquals(new String(expected.stdout(), UTF_8), new String(jq.run(), UTF_8));
+            }
+        }
+    }
+
+    @Test
+    public void timeoutStopsRunawayFilters() {
+        try (var jq = JqReactor.build()) {
+            var failure =
+                    assertThrows(
+                            JqTimeoutException.class,
+                            () -> jq.withInput("null")
+                                    .withFilter("repeat(1)")
+                                    .withTimeout(Duration.ofMillis(100))
+                                    .run());
+            assertFalse(failure.reactorDiscarded());
+            assertFalse(jq.reactor().isInterrupted());
+
+            var result = jq.withInput("{\"a\": 1}").withFilter(".a").run();
+            assertEquals("1\n", new String(result, UTF_8));
+        }
+    }
+
+    @Test
+    public void timeoutIgnoresSlowInputStreams() {
+        // three reads of 60ms each, past the 100ms budget jq gets
+        var slow = new InputStream() {
+            private final byte[][] parts = {"1 ".getBytes(UTF_8), "2 ".getBytes(UTF_8), "3".getBytes(UTF_8)};
+            private int next;
+
+            @Override
+            public int read() {
+                throw new UnsupportedOperationException();
+            }
+
+            @Override
+            public int read(byte[] b, int off, int len) {
+                if (next == parts.length) {
+                    return -1;
+                }
+                try {
+                    Thread.sleep(60);
+                } catch (InterruptedException e) {
+                    throw new AssertionError("reader was interrupted", e);
+                }
+                byte[] part = parts[next++];
+                System.arraycopy(part, 0, b, off, part.length);
+                return part.length;
+            }
+        };
+
+        try (var jq = JqReactor.build()) {
+            jq.reactor().setTimeout(Duration.ofMillis(100));
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(slow, ". * 2".getBytes(UTF_8), 0, out);
+            assertEquals("2\n4\n6\n", out.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void debugMessagesDoNotAccumulate() {
+        try (var jq = JqReactor.build()) {
+            var filter = "[range(10000) | debug | stderr | debug(\"msg\")] | length";
+            jq.withInput("null").withFilter(filter).run();
+            long inUse = jq.reactor().heapStats().inUseBytes();
+            for (int i = 0; i < 20; i++) {
+                var result = jq.withInput("null").withFilter(filter).run();
+                assertEquals("10000\n", new String(result, UTF_8));
+            }
+
+            assertEquals(0, jq.reactor().stderr().length);
+            assertTrue(jq.reactor().heapStats().inUseBytes() < inUse + (1 << 20));
+        }
+    }
+
+    @Test
+    public void heapStatsTrackGuestAllocations() {
+        try (var jq = JqReactor.build()) {
+            var big = "[" + "1,".repeat(100_000) + "1]";
+            jq.withInput(big).withFilter("length").run();
+
+            var stats = jq.reactor().heapStats();
+            assertEquals(jq.reactor().memoryPages() * 65536L, stats.memoryBytes());
+            assertEquals(4L << 30, stats.memoryLimitBytes());
+            assertTrue(stats.inUseBytes() > 0);
+            assertTrue(stats.inUseBytes() <= stats.heapBytes());
+            assertTrue(stats.peakInUseBytes() > stats.inUseBytes());
+            assertTrue(stats.inputBufferBytes() >= big.length());
+        }
+    }
+
+    @Test
+    public void restoredSnapshotKeepsTheFilterCache() {
+        byte[] snapshot;
+        try (var template = JqReactor.build()) {
+            template.reactor().warmFilterCache(".a", ".b");
+            snapshot = template.reactor().snapshot();
+        }
+
+        try (var restored = JqReactor.restore(snapshot)) {
+            long hits = restored.reactor().filterCacheStats().hits();
+            var result = restored.withInput("{\"b\": 2}").withFilter(".b").run();
+
+            assertEquals("2\n", new String(result, UTF_8));
+            assertEquals(hits + 1, restored.reactor().filterCacheStats().hits());
+        }
+        assertThrows(IllegalArgumentException.class, () -> JqReactor.restore(new byte[8]));
+    }
+
+    @Test
+    public void filterCacheReusesCompiledPrograms() {
+        try (var jq = JqReactor.build().withFilterCacheSize(1)) {
+            jq.withInput("{\"a\": 1}").withFilter(".a").run();
+            jq.withInput("{\"a\": 2}").withFilter(".a").run();
+            var b = jq.withInput("{\"b\": 3}").withFilter(".b").withCompactOutput().run();
+
+            var stats = jq.reactor().filterCacheStats();
+            assertEquals("3\n", new String(b, UTF_8));
+            assertEquals(1, stats.hits());
+            assertEquals(2, stats.misses());
+            assertEquals(1, stats.evictions());
+        }
+    }
+
+    @Test
+    public void outputStreamSink() throws IOException {
+        try (var jq = JqReactor.build();
+                var out = new ByteArrayOutputStream()) {
+            jq.withInput(JqTest.class.getResourceAsStream("/fruits.json").readAllBytes())
+                    .withFilter(".[].name")
+                    .run(out);
+
+            var fruitsList = "\"apple\"\n" + "\"banana\"\n" + "\"kiwi\"\n";
+            assertEquals(fruitsList, out.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void streamResults() {
+        try (var jq = JqReactor.build()) {
+            var results = new ArrayList<String>();
+            jq.withInput("[1, {\"a\": 2}, \"three\"]")
+                    .withFilter(".[]")
+                    .withCompactOutput()
+                    .stream(r -> results.add(new String(r, UTF_8)));
+
+            assertEquals(List.of("1", "{\"a\":2}", "\"three\""), results);
+        }
+    }
+
+    @Test
+    public void streamStopsWhenConsumerFails() {
+        try (var jq = JqReactor.build()) {
+            var seen = new ArrayList<String>();
+            var failure = assertThrows(IllegalStateException.class, () ->
+                    jq.reactor().stream(
+                            "[1, 2, 3]".getBytes(UTF_8),
+                            ".[]".getBytes(UTF_8),
+                            JqReactor.FLAG_COMPACT,
+                            r -> {
+                                seen.add(new String(r, UTF_8));
+                                throw new IllegalStateException("stop");
+                            }));
+
+            assertEquals("stop", failure.getMessage());
+            assertEquals(List.of("1"), seen);
+
+            // the reactor is still usable afterwards
+            var ok = jq.withInput("{}").withFilter(".").withCompactOutput().run();
+            assertEquals("{}\n", new String(ok, UTF_8));
+        }
+    }
+
+    @Test
+    public void chunkedInputStream() {
+        var ndjson = new StringBuilder();
+        var expected = new StringBuilder();
+        for (int i = 0; i < 20_000; i++) {
+            ndjson.append("{\"i\":").append(i).append(",\"pad\":\"xxxxxxxx\"}\n");
+            expected.append(i).append('\n');
+        }
+        byte[] input = ndjson.toString().getBytes(UTF_8);
+
+        try (var jq = JqReactor.build()) {
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream(input), ".i".getBytes(UTF_8), JqReactor.FLAG_COMPACT, out);
+            assertEquals(expected.toString(), out.toString(UTF_8));
+
+            var slurped = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream(input),
+                    "length".getBytes(UTF_8),
+                    JqReactor.FLAG_SLURP,
+                    slurped);
+            assertEquals("20000\n", slurped.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void haltStopsChunkedInput() {
+        var ndjson = new StringBuilder();
+        for (int i = 0; i < 20_000; i++) {
+            ndjson.append("{\"i\":").append(i).append(",\"pad\":\"xxxxxxxx\"}\n");
+        }
+        byte[] input = ndjson.toString().getBytes(UTF_8);
+
+        try (var jq = JqReactor.build()) {
+            var in = new ByteArrayInputStream(input);
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    in,
+                    "if .i == 3 then halt else .i end".getBytes(UTF_8),
+                    JqReactor.FLAG_COMPACT,
+                    out);
+            assertEquals("0\n1\n2\n", out.toString(UTF_8));
+            assertTrue(in.available() > 0, "input after halt should not be read");
+
+            // halts in a later chunk, with the values before it already written
+            var failed = new ByteArrayOutputStream();
+            var e = assertThrows(
+                    JqException.class,
+                    () -> jq.reactor().process(
+                            new ByteArrayInputStream(input),
+                            "if .i == 15000 then \"stop\" | halt_error else empty end"
+                                    .getBytes(UTF_8),
+                            0,
+                            failed));
+            assertTrue(e.getMessage().contains("stop"), e.getMessage());
+
+            // the session was closed cleanly, the reactor keeps working
+            var again = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream(input),
+                    "select(.i % 5000 == 0) | .i".getBytes(UTF_8),
+                    0,
+                    again);
+            assertEquals("0\n5000\n10000\n15000\n", again.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void parseErrorEndsChunkedInput() {
+        var ndjson = new StringBuilder();
+        var expected = new StringBuilder();
+        for (int i = 0; i < 1_000; i++) {
+            ndjson.append("{\"i\":").append(i).append("}\n");
+            expected.append(i).append('\n');
+        }
+        // what follows the malformed value spans several chunks
+        ndjson.append("{\"i\": nope}\n");
+        for (int i = 1_000; i < 20_000; i++) {
+            ndjson.append("{\"i\":").append(i).append("}\n");
+        }
+
+        try (var jq = JqReactor.build()) {
+            var out = new ByteArrayOutputStream();
+            assertThrows(
+                    JqException.class,
+                    () -> jq.reactor().process(
+                            new ByteArrayInputStream(ndjson.toString().getBytes(UTF_8)),
+                            ".i".getBytes(UTF_8),
+                            0,
+                            out));
+            assertEquals(expected.toString(), out.toString(UTF_8));
+
+            var again = jq.withInput("{\"i\": 1}").withFilter(".i").run();
+            assertEquals("1\n", new String(again, UTF_8));
+        }
+    }
+
+    @Test
+    public void chunkedRawInputStream() {
+        // the second line straddles the 64KiB feed boundary
+        var text = new StringBuilder("x".repeat(65530)).append('\n');
+        var expected = new StringBuilder("65530\n");
+        for (int i = 0; i < 20_000; i++) {
+            String line = "line " + i + " of the raw input";
+            text.append(line).append('\n');
+            expected.append(line.length()).append('\n');
+        }
+        byte[] input = text.toString().getBytes(UTF_8);
+
+        try (var jq = JqReactor.build()) {
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream(input),
+                    "length".getBytes(UTF_8),
+                    JqReactor.FLAG_RAW_INPUT,
+                    out);
+            assertEquals(expected.toString(), out.toString(UTF_8));
+
+            var slurped = new ByteArrayOutputStream();
+            jq.reactor().process(
+                    new ByteArrayInputStream(input),
+                    "length".getBytes(UTF_8),
+                    JqReactor.FLAG_RAW_INPUT | JqReactor.FLAG_SLURP,
+                    slurped);
+            assertEquals(input.length + "\n", slurped.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void fileInputWithCustomMemoryFactory(@TempDir Path dir) throws IOException {
+        Path file = dir.resolve("input.ndjson");
+        Files.writeString(file, "{\"a\":1}\n{\"a\":2}\n");
+
+        try (var jq = JqReactor.build(ByteArrayMemory::new)) {
+            var out = new ByteArrayOutputStream();
+            jq.reactor().process(file, ".a".getBytes(UTF_8), 0, out);
+            assertEquals("1\n2\n", out.toString(UTF_8));
+        }
+    }
+
+    @Test
+    public void batchOfInputs() {
+        try (var jq = JqReactor.build();
+                var filter = jq.reactor().compile("{id: .id, n: (.tags | length)}")) {
+            var inputs = new ArrayList<byte[]>();
+            for (int i = 0; i < 100; i++) {
+                inputs.add(("{\"id\":" + i + ",\"tags\":[" + "1,".repeat(i % 3) + "0]}")
+                        .getBytes(UTF_8));
+            }
+
+            var outputs = jq.reactor().processBatch(inputs, filter, JqReactor.FLAG_COMPACT);
+
+            assertEquals(100, outputs.size());
+            for (int i = 0; i < 100; i++) {
+                assertEquals(
+                        "{\"id\":" + i + ",\"n\":" + (i % 3 + 1) + "}\n",
+                        new String(outputs.get(i), UTF_8));
+            }
+        }
+    }
+
     @Test
     public void error() {
         // Arrange
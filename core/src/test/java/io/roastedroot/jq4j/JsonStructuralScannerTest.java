@@ -0,0 +1,75 @@
+package io.roastedroot.jq4j;
+
+import static java.nio.charset.StandardCharsets.UTF_8;
+import static org.junit.jupiter.api.Assertions.assertEquals;
+
+import java.util.ArrayList;
+import java.util.List;
+import org.junit.jupiter.api.Test;
+
+public class JsonStructuralScannerTest {
+
+    private static final String[] VALUES = {
+        "{\"a\":[1,2,{\"b\":\"}]\"}]}",
+        "\"a long string with \\\"escaped\\\" quotes, \\\\ and ] } inside\"",
+        "[[[[[[[[[[]]]]]]]]]]",
+        "12345",
+        "{\"k\":\"\\\\\"}",
+        "true",
+        "[\"éè multi-byte ☃ text {\"]",
+    };
+
+    @Test
+    public void findsEveryTopLevelBoundary() {
+        var text = new StringBuilder();
+        var expected = new ArrayList<Integer>();
+        for (int round = 0; round < 8; round++) {
+            for (String value : VALUES) {
+                // shift the values across word offsets
+                text.append(" ".repeat(round)).append(value).append('\n');
+                expected.add(text.toString().getBytes(UTF_8).length
+                        - (isScalar(value) ? 0 : 1));
+            }
+        }
+        byte[] input = text.toString().getBytes(UTF_8);
+
+        var scanner = new JsonStructuralScanner();
+        assertEquals(expected, boundaries(scanner, input, input.length));
+        assertEquals(expected.size(), scanner.values());
+    }
+
+    @Test
+    public void stateCarriesAcrossPieces() {
+        var text = new StringBuilder();
+        for (int round = 0; round < 4; round++) {
+            for (String value : VALUES) {
+                text.append(value).append(round % 2 == 0 ? "\n" : "\r\n\t ");
+            }
+        }
+        byte[] input = text.toString().getBytes(UTF_8);
+        var whole = boundaries(new JsonStructuralScanner(), input, input.length);
+
+        for (int piece = 1; piece <= 17; piece++) {
+            assertEquals(whole, boundaries(new JsonStructuralScanner(), input, piece),
+                    "piece size " + piece);
+        }
+    }
+
+    private static boolean isScalar(String value) {
+        return value.charAt(0) != '{' && value.charAt(0) != '[';
+    }
+
+    private static List<Integer> boundaries(JsonStructuralScanner scanner, byte[] input, int piece) {
+        var found = new ArrayList<Integer>();
+        for (int start = 0; start < input.length; start += piece) {
+            int end = Math.min(start + piece, input.length);
+            int from = start;
+            int boundary;
+            while (from < end && (boundary = scanner.nextBoundary(input, from, end)) >= 0) {
+                found.add(boundary);
+                from = boundary;
+            }
+        }
+        return found;
+    }
+}